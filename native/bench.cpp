@@ -0,0 +1,697 @@
+/*
+  Headless benchmark runner for the native build (pio run -e native).
+
+  Boots the game with setup(), then plays every level and every screensaver
+  for a number of frames on the virtual clock of the native HAL and reports
+  the wall clock cost of loop(). The fire button is pressed once a second so
+  attacks, kills and deaths are part of the measurement. The swarm runs show
+  how the cost grows with the number of enemies, build with -DENEMY_SWARM
+  (pio run -e native_swarm) for the ones beyond the default pool.
+
+  Usage: .pio/build/native/program [frames per run] [led count] [show ns per led] [mpu stream]
+
+  The third one makes the stand-in FastLED.show() take as long as sending the
+  frame to a real strip, e.g. 30000 for WS2812, and the frames as long as the
+  game makes them for such a strip (see frame_pace()).
+
+  At the end, an MPU stream (see native/hal/mpu6050.h) is replayed through the
+  gyro input for as many frames, the given file or else a made up one of a
+  spring that is tilted to and fro and twanged once a second. It compares the
+  attacks and the lag of the tilt with what one sample per frame and the
+  median of the last 5 gave, before the sensor task and the tilt filter.
+*/
+#include <Arduino.h>
+#include <FastLED.h>
+#include <Wire.h>
+#include <fstream>
+#include <iterator>
+#include <vector>
+#include "../src/config.h"
+#include "../src/iSin.h"
+#include "../src/samples.h"
+
+// in TWANG32.ino
+void setup();
+void loop();
+int bench_levelCount();
+int bench_screensaverCount();
+void bench_setLedCount(int count);
+void bench_startLevel(int num);
+int bench_startSwarm(int count);
+bool bench_inLevel(int num);
+long bench_startScreensaver(int mode);
+void bench_printProfile();
+uint32_t bench_frameIntervalUs();
+long bench_getLED(int count);
+void bench_stripSetup(CRGB **strip, int *first, int *last, int *minBrightness, int *maxSpeed);
+void bench_lavaTexture(int first, int last);
+void bench_conveyor(int first, int last, long shift);
+#ifdef USE_MPU
+void bench_mpuSample();
+bool bench_mpuConnected();
+int bench_input(int *tilt, int *wobble);
+void bench_joystickSetup(int *axis, int *restAxis, int *gyroAxis, int *gyroSign, int *deadzone, bool *flipped);
+#endif
+int bench_attackThreshold();
+#ifdef USE_C64_JOYSTICK
+void bench_c64Input(int *tilt, int *wobble);
+#endif
+#ifdef USE_SCRIPTED_INPUT
+void bench_setInput(int tilt, int wobble);
+#endif
+void bench_printInputStats();
+
+#define DEFAULT_FRAMES 600
+#define DEFAULT_LED_COUNT 300
+
+#define FIRE_INTERVAL_US 1000000 // game time, the frame rate may change
+#define FIRE_WOBBLE 30000         // what a C64 joystick gives
+
+const int SWARM_SIZES[] = {10, 64, 256};
+
+#define GETLED_SWEEPS 2000
+#define TRIG_CALLS 10000000
+#define SAMPLE_CALLS 10000000
+#define LAVA_FILLS 2000
+#define CONVEYOR_FILLS 200
+
+#define SYNTH_MPU_HZ 1000
+#define SYNTH_MPU_SECONDS 4
+#define SYNTH_MOVE_S 0.4     // time the made up spring takes from one position to the next
+#define SYNTH_GYRO_BIAS 150 // raw, a bit more than 1 deg/s
+#define SNAPSHOT_FRAMES 5    // the window of the median tilt and highest wobble, back when the game read one sample per frame
+#define LAG_MAX_FRAMES 10
+
+#define C64_TAP_INTERVAL_US 100000
+#define C64_TAP_MIN_US 2000
+#define C64_TAP_MAX_US 40000
+#define C64_BOUNCES 4     // extra edges at every press and release
+#define C64_BOUNCE_US 200 // between them
+
+typedef struct
+{
+    int frames;
+    double total_us;
+    double max_us;
+} BenchResult;
+
+static double frame(int num)
+{
+    static uint64_t nextFireUs = 0;
+    const bool fire = num == 0 || hal::now_us >= nextFireUs;
+    if (fire)
+        nextFireUs = hal::now_us + FIRE_INTERVAL_US;
+#ifdef USE_SCRIPTED_INPUT
+    bench_setInput(0, fire ? FIRE_WOBBLE : 0);
+#endif
+    hal::advance_us(bench_frameIntervalUs()); // exactly one frame is due per loop()
+#ifdef USE_MPU
+    bench_mpuSample(); // the sensor task keeps up on the ESP32
+#endif
+
+    auto start = std::chrono::steady_clock::now();
+    loop();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::micro>(end - start).count();
+}
+
+// sin(ms / 500.0) the libm way and with iSin.h, like the animations use it
+static void benchTrig()
+{
+    const uint32_t rate = isinRate(500.0);
+
+    auto start = std::chrono::steady_clock::now();
+    double libmSum = 0;
+    for (uint32_t ms = 0; ms < TRIG_CALLS; ms++)
+        libmSum += sin(ms / 500.0);
+    auto mid = std::chrono::steady_clock::now();
+    long isinSum = 0;
+    for (uint32_t ms = 0; ms < TRIG_CALLS; ms++)
+        isinSum += isin16(isinPhase(ms, rate));
+    auto end = std::chrono::steady_clock::now();
+
+    double maxError = 0;
+    for (uint32_t ms = 0; ms < 100000; ms++)
+        maxError = std::max(maxError, fabs(sin(ms / 500.0) - isin16(isinPhase(ms, rate)) / (double)ISIN_MAX));
+
+    printf("sin():     %.2f ns per call (checksum %.0f)\n",
+           std::chrono::duration<double, std::nano>(mid - start).count() / TRIG_CALLS, libmSum);
+    printf("isin16():  %.2f ns per call (checksum %.0f), max error %.6f\n",
+           std::chrono::duration<double, std::nano>(end - mid).count() / TRIG_CALLS, isinSum / (double)ISIN_MAX, maxError);
+}
+
+// samples.h as it was, a window of 5 ints, median with qsort() and highest by
+// scanning all of them
+typedef struct
+{
+    int values[5];
+    int sorted[5];
+    int index;
+} QsortSamples;
+
+static int cmpInt(const void *a, const void *b)
+{
+    return *(const int *)a - *(const int *)b;
+}
+
+static void qsortAdd(QsortSamples *s, int val)
+{
+    s->values[s->index] = val;
+    s->index = (s->index + 1) % 5;
+}
+
+static int qsortMedian(QsortSamples *s)
+{
+    memcpy(s->sorted, s->values, sizeof(s->values));
+    qsort(s->sorted, 5, sizeof(s->values[0]), cmpInt);
+    return s->sorted[2];
+}
+
+static int qsortHighest(QsortSamples *s)
+{
+    int result = s->values[0];
+    for (int idx = 1; idx < 5; ++idx)
+        result = std::max(result, s->values[idx]);
+    return result;
+}
+
+// ns per add and query of the window, add() and query() take the value to add
+template <typename Add, typename Query>
+static void benchSampleWindow(const char *name, const std::vector<int> &input, Add add, Query query)
+{
+    auto start = std::chrono::steady_clock::now();
+    long sum = 0;
+    for (uint32_t i = 0; i < SAMPLE_CALLS; i++)
+    {
+        add(input[i & (input.size() - 1)]);
+        sum += query();
+    }
+    auto end = std::chrono::steady_clock::now();
+    printf("%-24s %.2f ns per sample (checksum %ld)\n", name,
+           std::chrono::duration<double, std::nano>(end - start).count() / SAMPLE_CALLS, sum);
+}
+
+template <uint8_t N>
+static void benchSamplesOf(const std::vector<int> &input)
+{
+    Samples<int, N> s;
+    char name[32];
+    snprintf(name, sizeof(name), "Samples<%d> median", N);
+    benchSampleWindow(name, input, [&](int v) { sample_add(&s, v); }, [&] { return sample_median(&s); });
+    snprintf(name, sizeof(name), "Samples<%d> highest", N);
+    benchSampleWindow(name, input, [&](int v) { sample_add(&s, v); }, [&] { return sample_highest(&s); });
+}
+
+// the gyro windows: samples.h with qsort() against the templates, on the rates
+// the gyro reads when the spring wobbles, a noisy 40 Hz swing at 1 kHz
+static void benchSamples()
+{
+    std::vector<int> input(4096);
+    uint32_t seed = 1;
+    for (size_t i = 0; i < input.size(); i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        input[i] = 20000 * sin(2 * M_PI * 40 * i / SYNTH_MPU_HZ) + (int)(seed >> 16) % 512 - 256;
+    }
+
+    QsortSamples q = {{0}, {0}, 0};
+    benchSampleWindow("qsort() median", input, [&](int v) { qsortAdd(&q, v); }, [&] { return qsortMedian(&q); });
+    benchSampleWindow("scan highest", input, [&](int v) { qsortAdd(&q, v); }, [&] { return qsortHighest(&q); });
+    benchSamplesOf<5>(input);
+    benchSamplesOf<15>(input);
+}
+
+// The strip as the game draws it, see bench_stripSetup()
+typedef struct
+{
+    CRGB *leds;
+    int first, last;
+    int minBrightness, maxSpeed;
+} StripSetup;
+
+static StripSetup stripSetup()
+{
+    StripSetup s;
+    bench_stripSetup(&s.leds, &s.first, &s.last, &s.minBrightness, &s.maxSpeed);
+    return s;
+}
+
+// fills the whole strip with ON and OFF lava count times each, the way
+// tickLava() did before LavaTexture (a random8() per LED) or with the texture.
+// Returns how many LEDs were filled.
+static long benchLava(int count, bool texture)
+{
+    const StripSetup st = stripSetup();
+    for (int c = 0; c < count; c++)
+    {
+        if (texture)
+        {
+            bench_lavaTexture(st.first, st.last);
+            continue;
+        }
+        for (int p = st.first; p <= st.last; p++)
+        {
+            int flicker = random8(LAVA_OFF_BRIGHTNESS);
+            st.leds[p] = CRGB(LAVA_OFF_BRIGHTNESS + flicker, (LAVA_OFF_BRIGHTNESS + flicker) * 2 / 3, 0);
+        }
+        for (int p = st.first; p <= st.last; p++)
+        {
+            if (random8(30) < 29)
+                st.leds[p] = CRGB(150, 0, 0);
+            else
+                st.leds[p] = CRGB(180, 100, 0);
+        }
+    }
+    return 2L * count * (st.last - st.first + 1);
+}
+
+// draws a conveyor over the whole strip for every speed at count points in
+// time, the way tickConveyors() did before the patterns (a divide and a
+// modulo per LED) or with them. Returns how many LEDs were drawn, checksum
+// is the same for both when they look the same.
+static long benchConveyors(int count, bool pattern, long *checksum)
+{
+    const StripSetup st = stripSetup();
+    const int brightnessMap[] = {
+        st.minBrightness,
+        st.minBrightness + (CONVEYOR_BRIGHTNESS - st.minBrightness) / 12,
+        st.minBrightness + (CONVEYOR_BRIGHTNESS - st.minBrightness) / 6,
+        st.minBrightness + (CONVEYOR_BRIGHTNESS - st.minBrightness) / 3,
+        CONVEYOR_BRIGHTNESS,
+    };
+    const int levels = sizeof(brightnessMap) / sizeof(brightnessMap[0]);
+    long sum = 0;
+    for (int c = 0; c < count; c++)
+    {
+        long m = 10000 + c * 17;
+        for (int speed = -st.maxSpeed + 1; speed < st.maxSpeed; speed++)
+        {
+            long shift = m * speed / 500;
+            if (pattern)
+                bench_conveyor(st.first, st.last, shift);
+            else
+            {
+                for (int led = st.first; led <= st.last; led++)
+                {
+                    int b = brightnessMap[abs((-led + shift) % levels)];
+                    st.leds[led] = CRGB(b, b, b);
+                }
+            }
+            for (int led = st.first; led <= st.last; led++)
+                sum += st.leds[led].r * (led + 1);
+        }
+    }
+    *checksum = sum;
+    return (long)count * (st.maxSpeed * 2 - 1) * (st.last - st.first + 1);
+}
+
+static void report(const char *name, int num, BenchResult r)
+{
+    printf("%-12s %3d %7d %10.2f %10.2f %12.1f\n",
+           name, num, r.frames, r.total_us / r.frames, r.max_us, r.frames * 1e6 / r.total_us);
+}
+
+static BenchResult runLevel(int num, int frames)
+{
+    BenchResult r = {0};
+    bench_startLevel(num);
+    for (int f = 0; f < frames; ++f)
+    {
+        if (!bench_inLevel(num))
+            bench_startLevel(num);
+        double us = frame(f);
+        r.frames++;
+        r.total_us += us;
+        r.max_us = std::max(r.max_us, us);
+    }
+    return r;
+}
+
+static BenchResult runSwarm(int count, int frames)
+{
+    BenchResult r = {0};
+    if (bench_startSwarm(count) < count)
+        return r;
+    for (int f = 0; f < frames; ++f)
+    {
+        double us = frame(f);
+        r.frames++;
+        r.total_us += us;
+        r.max_us = std::max(r.max_us, us);
+    }
+    return r;
+}
+
+static BenchResult runScreensaver(int mode, int frames)
+{
+    BenchResult r = {0};
+    hal::advance_us((uint64_t)bench_startScreensaver(mode) * 1000);
+    for (int f = 0; f < frames; ++f)
+    {
+        double us = frame(f);
+        r.frames++;
+        r.total_us += us;
+        r.max_us = std::max(r.max_us, us);
+    }
+    return r;
+}
+
+#ifdef USE_MPU
+static void putInt16(std::vector<uint8_t> *stream, int value)
+{
+    const int16_t v = constrain(value, -32768, 32767);
+    stream->push_back((uint16_t)v >> 8);
+    stream->push_back(v & 0xFF);
+}
+
+// Joystick setup of the game, see bench_joystickSetup()
+typedef struct
+{
+    int axis, restAxis, gyroAxis, gyroSign, deadzone;
+    bool flipped;
+} JoystickSetup;
+
+static JoystickSetup joystickSetup()
+{
+    JoystickSetup js;
+    bench_joystickSetup(&js.axis, &js.restAxis, &js.gyroAxis, &js.gyroSign, &js.deadzone, &js.flipped);
+    return js;
+}
+
+// Tilt angle of the made up spring at t s and how fast it changes (rad, rad/s):
+// it rests level, then moves to 29 degrees, to -29 and back, a new position
+// every second, reached after SYNTH_MOVE_S (within the 250 deg/s of the gyro)
+static double synthTilt(double t, double *rate)
+{
+    static const double POSITIONS[SYNTH_MPU_SECONDS] = {0, 0.5, -0.5, 0.25};
+    const int second = (int)t % SYNTH_MPU_SECONDS;
+    const double from = POSITIONS[(second + SYNTH_MPU_SECONDS - 1) % SYNTH_MPU_SECONDS];
+    const double to = POSITIONS[second];
+    const double u = std::min(fmod(t, 1.0) / SYNTH_MOVE_S, 1.0);
+    *rate = u < 1 ? (to - from) * M_PI / 2 * sin(M_PI * u) / SYNTH_MOVE_S : 0;
+    return from + (to - from) * (1 - cos(M_PI * u)) / 2;
+}
+
+// The made up spring: tilted from one position to the next, twanged once a
+// second while it rests (a damped 40 Hz swing on the gyro axis the game reads
+// the wobble of, which shakes the accel a bit too), with sensor noise and a
+// gyro that is off by SYNTH_GYRO_BIAS
+static std::vector<uint8_t> synthMpuStream()
+{
+    const JoystickSetup js = joystickSetup();
+    std::vector<uint8_t> stream = hal::mpu_streamHeader(SYNTH_MPU_HZ, false);
+    uint32_t seed = 1;
+    for (int i = 0; i < SYNTH_MPU_HZ * SYNTH_MPU_SECONDS; i++)
+    {
+        const double t = i / (double)SYNTH_MPU_HZ;
+        double rate;
+        const double tilt = synthTilt(t, &rate);
+        const double sinceTwang = fmod(t, 1.0) - 0.5;
+        const double twang = sinceTwang >= 0 ? 50000 * exp(-sinceTwang / 0.02) * sin(2 * M_PI * 40 * sinceTwang) : 0;
+
+        double values[6] = {0, 0, 0, 0, 0, 0};
+        values[js.axis] = 16384 * sin(tilt) + twang / 10;
+        values[js.restAxis] = 16384 * cos(tilt);
+        values[3 + js.gyroAxis] = js.gyroSign * rate * 180 / M_PI * 131 + SYNTH_GYRO_BIAS;
+        values[3 + js.axis] += twang;
+        for (double v : values)
+        {
+            seed = seed * 1103515245 + 12345;
+            putInt16(&stream, (int)v + (int)(seed >> 16) % 128 - 64); // sensor noise
+        }
+    }
+    return stream;
+}
+
+// the old way to a tilt: accel / 166 less the deadzone
+static int deadzoned(int accel, const JoystickSetup &js)
+{
+    int a = accel / 166;
+    if (abs(a) < js.deadzone)
+        a = 0;
+    if (a > 0)
+        a -= js.deadzone;
+    if (a < 0)
+        a += js.deadzone;
+    return js.flipped ? -a : a;
+}
+
+// How far (in frames, with a fraction) tilts lags behind reference: the shift
+// with the least squared difference, rms gets the difference at that shift
+static double lagFrames(const std::vector<int> &tilts, const std::vector<int> &reference, double *rms)
+{
+    double errors[LAG_MAX_FRAMES + 1];
+    int best = 0;
+    for (int shift = 0; shift <= LAG_MAX_FRAMES; shift++)
+    {
+        double sum = 0;
+        for (size_t f = LAG_MAX_FRAMES; f < tilts.size(); f++)
+        {
+            const double d = tilts[f] - reference[f - shift];
+            sum += d * d;
+        }
+        errors[shift] = sum / (tilts.size() - LAG_MAX_FRAMES);
+        if (errors[shift] < errors[best])
+            best = shift;
+    }
+    *rms = sqrt(errors[best]);
+    if (best == 0 || best == LAG_MAX_FRAMES)
+        return best;
+    const double curve = errors[best - 1] - 2 * errors[best] + errors[best + 1];
+    return curve > 0 ? best + (errors[best - 1] - errors[best + 1]) / (2 * curve) : best;
+}
+
+// Replays stream through the gyro input for frames frames. Measures the
+// attacks (wobble crossing the threshold) and the tilt, next to what the game
+// made of one sample per frame before the sensor task: the highest wobble and
+// the median tilt of the last SNAPSHOT_FRAMES frames. The lag of both tilts is
+// measured against the tilt of the newest accel sample, unfiltered.
+static void runMpuReplay(const char *name, const std::vector<uint8_t> &stream, int frames)
+{
+    uint16_t rateHz;
+    if (!hal::mpu_attachStream(stream, &rateHz))
+    {
+        printf("mpu replay   %s is not an MPU stream\n", name);
+        return;
+    }
+    // the game finds the gyro within its reconnect interval
+    for (int f = 0; f < 1000 && !bench_mpuConnected(); f++)
+    {
+        hal::advance_us(bench_frameIntervalUs());
+        bench_mpuSample();
+    }
+    if (!bench_mpuConnected())
+    {
+        printf("mpu replay   %s, the game did not connect to the gyro\n", name);
+        return;
+    }
+    int tilt, wobble;
+    bench_input(&tilt, &wobble); // drop what came in while connecting
+
+    const JoystickSetup js = joystickSetup();
+    const int threshold = bench_attackThreshold();
+    const uint32_t transfersBefore = hal::i2c_transfers;
+    long samples = 0;
+    int attacks = 0, snapshotAttacks = 0;
+    bool attacking = false, snapshotAttacking = false;
+    int wobbles[SNAPSHOT_FRAMES] = {0};
+    int angles[SNAPSHOT_FRAMES] = {0};
+    std::vector<int> tilts, snapshotTilts, reference;
+    double inputUs = 0;
+    for (int f = 0; f < frames; f++)
+    {
+        hal::advance_us(bench_frameIntervalUs());
+        bench_mpuSample();
+
+        auto start = std::chrono::steady_clock::now();
+        samples += bench_input(&tilt, &wobble);
+        inputUs += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        attacks += !attacking && wobble >= threshold;
+        attacking = wobble >= threshold;
+        tilts.push_back(tilt);
+
+        const hal::Mpu6050 &mpu = hal::mpu6050s[0];
+        wobbles[f % SNAPSHOT_FRAMES] = mpu.Latest(3 + js.axis);
+        const int snapshotWobble = abs(*std::max_element(wobbles, wobbles + SNAPSHOT_FRAMES));
+        snapshotAttacks += !snapshotAttacking && snapshotWobble >= threshold;
+        snapshotAttacking = snapshotWobble >= threshold;
+        angles[f % SNAPSHOT_FRAMES] = deadzoned(mpu.Latest(js.axis), js);
+        int sorted[SNAPSHOT_FRAMES];
+        std::copy(angles, angles + SNAPSHOT_FRAMES, sorted);
+        std::nth_element(sorted, sorted + SNAPSHOT_FRAMES / 2, sorted + SNAPSHOT_FRAMES);
+        snapshotTilts.push_back(sorted[SNAPSHOT_FRAMES / 2]);
+        reference.push_back(deadzoned(mpu.Latest(js.axis), js));
+    }
+
+    const double frameMs = bench_frameIntervalUs() / 1000.0;
+    double rms, snapshotRms;
+    const double lag = lagFrames(tilts, reference, &rms) * frameMs;
+    const double snapshotLag = lagFrames(snapshotTilts, reference, &snapshotRms) * frameMs;
+    printf("mpu replay   %s, %u Hz, %d frames, %ld samples (%.1f per frame), %.2f I2C transfers per sample, input %.2f us per frame\n",
+           name, rateHz, frames, samples, samples / (double)frames,
+           (hal::i2c_transfers - transfersBefore) / (double)std::max(samples, 1L), inputUs / frames);
+    printf("             every sample:          %2d attacks, tilt lags %5.1f ms, rms difference %4.1f\n", attacks, lag, rms);
+    printf("             one sample per frame:  %2d attacks, tilt lags %5.1f ms, rms difference %4.1f\n", snapshotAttacks, snapshotLag, snapshotRms);
+}
+#endif
+
+#ifdef USE_C64_JOYSTICK
+// Taps fire every C64_TAP_INTERVAL_US for C64_TAP_MIN_US to C64_TAP_MAX_US,
+// starting anywhere in a frame and bouncing at press and release. Counts the
+// taps the game attacked on and how long after the press it did, next to
+// what reading the pin once per frame (as the game did before) saw.
+static void runC64(int frames)
+{
+    const uint32_t intervalUs = bench_frameIntervalUs();
+    const uint64_t startUs = hal::now_us;
+    const uint64_t endUs = startUs + (uint64_t)frames * intervalUs;
+    std::vector<std::pair<uint64_t, uint8_t>> edges;
+    std::vector<uint64_t> presses;
+    uint32_t seed = 7;
+    for (uint64_t t = startUs + C64_TAP_INTERVAL_US; t + C64_TAP_INTERVAL_US <= endUs; t += C64_TAP_INTERVAL_US)
+    {
+        seed = seed * 1103515245 + 12345;
+        const uint64_t press = t + (seed >> 8) % intervalUs;
+        const uint64_t release = press + C64_TAP_MIN_US + (seed >> 16) % (C64_TAP_MAX_US - C64_TAP_MIN_US);
+        for (int bounce = 0; bounce <= C64_BOUNCES; bounce++)
+            edges.push_back({press + bounce * C64_BOUNCE_US, bounce % 2 ? LOW : HIGH});
+        for (int bounce = 0; bounce <= C64_BOUNCES; bounce++)
+            edges.push_back({release + bounce * C64_BOUNCE_US, bounce % 2 ? HIGH : LOW});
+        presses.push_back(press);
+    }
+
+    const int threshold = bench_attackThreshold();
+    size_t next = 0;
+    int attacks = 0, polledTaps = 0;
+    bool attacking = false, polledHigh = false;
+    double latencyUs = 0, maxLatencyUs = 0;
+    for (int f = 0; f < frames; f++)
+    {
+        const uint64_t frameUs = hal::now_us + intervalUs;
+        for (; next < edges.size() && edges[next].first <= frameUs; next++)
+        {
+            hal::advance_us(edges[next].first - hal::now_us);
+            hal::set_pin(C64_JOY_PIN_FIRE, edges[next].second);
+        }
+        hal::advance_us(frameUs - hal::now_us);
+
+        polledTaps += !polledHigh && hal::pins[C64_JOY_PIN_FIRE] == HIGH;
+        polledHigh = hal::pins[C64_JOY_PIN_FIRE] == HIGH;
+        int tilt, wobble;
+        bench_c64Input(&tilt, &wobble);
+        if (!attacking && wobble >= threshold && attacks < (int)presses.size())
+        {
+            const double latency = hal::now_us - presses[attacks++];
+            latencyUs += latency;
+            maxLatencyUs = std::max(maxLatencyUs, latency);
+        }
+        attacking = wobble >= threshold;
+    }
+    hal::set_pin(C64_JOY_PIN_FIRE, LOW);
+
+    printf("c64 fire     %zu taps of %d to %d ms with %d bounces, %d frames of %.1f ms\n",
+           presses.size(), C64_TAP_MIN_US / 1000, C64_TAP_MAX_US / 1000, C64_BOUNCES, frames, intervalUs / 1000.0);
+    printf("             edges:          %3d attacks, %.1f ms after the press on average, %.1f ms at most\n",
+           attacks, latencyUs / std::max(attacks, 1) / 1000, maxLatencyUs / 1000);
+    printf("             once per frame: %3d taps seen\n", polledTaps);
+}
+#endif
+
+int main(int argc, char **argv)
+{
+    int frames = argc > 1 ? atoi(argv[1]) : DEFAULT_FRAMES;
+    int ledCount = argc > 2 ? atoi(argv[2]) : DEFAULT_LED_COUNT;
+    int showNsPerLed = argc > 3 ? atoi(argv[3]) : 0;
+    const char *mpuStreamPath = argc > 4 ? argv[4] : NULL;
+    if (frames <= 0 || ledCount <= 0 || showNsPerLed < 0)
+    {
+        fprintf(stderr, "usage: %s [frames per run] [led count] [show ns per led] [mpu stream]\n", argv[0]);
+        return 1;
+    }
+    hal::show_ns_per_led = showNsPerLed;
+
+    setup();
+    bench_setLedCount(ledCount);
+
+    printf("TWANG32 native benchmark, %d frames per run, %d LEDs (MAX_LEDS %d), show %d ns per LED\n",
+           frames, ledCount, MAX_LEDS, showNsPerLed);
+    printf("%-12s %3s %7s %10s %10s %12s\n", "run", "#", "frames", "avg us", "max us", "frames/s");
+
+    BenchResult total = {0};
+    const uint64_t serialBefore = hal::serial_bytes;
+    for (int num = 0; num < bench_levelCount(); ++num)
+    {
+        BenchResult r = runLevel(num, frames);
+        report("level", num, r);
+        total.frames += r.frames;
+        total.total_us += r.total_us;
+        total.max_us = std::max(total.max_us, r.max_us);
+    }
+    for (int mode = 0; mode < bench_screensaverCount(); ++mode)
+    {
+        report("screensaver", mode, runScreensaver(mode, frames));
+    }
+    report("all levels", bench_levelCount(), total);
+    const double serialPerFrame = (hal::serial_bytes - serialBefore) / (double)total.frames;
+    for (int count : SWARM_SIZES)
+    {
+        BenchResult r = runSwarm(count, frames);
+        if (r.frames)
+            report("swarm", count, r);
+        else
+            printf("%-12s %3d  does not fit the enemy pool, build with -DENEMY_SWARM\n", "swarm", count);
+    }
+
+    printf("\nserial output in the levels: %.1f bytes per frame, %.0f us at 115200 baud\n", serialPerFrame, serialPerFrame * 10 * 1e6 / 115200);
+    bench_printProfile();
+
+    auto start = std::chrono::steady_clock::now();
+    long sum = bench_getLED(GETLED_SWEEPS);
+    auto end = std::chrono::steady_clock::now();
+    printf("\ngetLED(): %.2f ns per call (checksum %ld)\n",
+           std::chrono::duration<double, std::nano>(end - start).count() / (GETLED_SWEEPS * (VIRTUAL_LED_COUNT + 21.0)), sum);
+    benchTrig();
+    benchSamples();
+
+    const char *lavaNames[] = {"random8()", "texture"};
+    for (int texture = 0; texture < 2; texture++)
+    {
+        auto lavaStart = std::chrono::steady_clock::now();
+        long filled = benchLava(LAVA_FILLS, texture);
+        auto lavaEnd = std::chrono::steady_clock::now();
+        printf("lava %-9s %.2f ns per LED\n", lavaNames[texture],
+               std::chrono::duration<double, std::nano>(lavaEnd - lavaStart).count() / filled);
+    }
+
+    const char *conveyorNames[] = {"modulo", "pattern"};
+    for (int pattern = 0; pattern < 2; pattern++)
+    {
+        auto convStart = std::chrono::steady_clock::now();
+        long sum;
+        long drawn = benchConveyors(CONVEYOR_FILLS, pattern, &sum);
+        auto convEnd = std::chrono::steady_clock::now();
+        printf("conveyor %-8s %.2f ns per LED (checksum %ld)\n", conveyorNames[pattern],
+               std::chrono::duration<double, std::nano>(convEnd - convStart).count() / drawn, sum);
+    }
+
+    printf("\n");
+#ifdef USE_C64_JOYSTICK
+    runC64(frames);
+#endif
+#ifdef USE_MPU
+    if (mpuStreamPath)
+    {
+        std::ifstream file(mpuStreamPath, std::ios::binary);
+        runMpuReplay(mpuStreamPath, std::vector<uint8_t>(std::istreambuf_iterator<char>(file), {}), frames);
+    }
+    else
+    {
+        runMpuReplay("synthetic", synthMpuStream(), frames);
+    }
+#endif
+
+    printf("\n");
+    bench_printInputStats();
+
+    return 0;
+}
@@ -0,0 +1,442 @@
+/*
+  Minimal stand-in for the Arduino ESP32 core, used by the native build.
+
+  Only the parts TWANG32 actually uses are implemented. Time does not pass on
+  its own: millis()/micros() read a virtual clock that is advanced by delay(),
+  delayMicroseconds() and the benchmark runner (hal::advance_us()), so a run is
+  reproducible and can go faster than real time.
+
+  FreeRTOS tasks are backed by std::thread, task notifications by a condition
+  variable, so the FastLED show task runs the same way it does on the ESP32.
+*/
+#ifndef NATIVE_HAL_ARDUINO_H
+#define NATIVE_HAL_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <assert.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cmath>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+using std::abs;
+using std::max;
+using std::min;
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define IRAM_ATTR
+#define PROGMEM
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define INPUT_PULLDOWN 0x09
+
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+
+#define DEC 10
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+// ---------------------------------
+// ----------- HAL STATE -----------
+// ---------------------------------
+namespace hal
+{
+    // virtual time since boot
+    inline uint64_t now_us = 0;
+
+    inline void advance_us(uint64_t us)
+    {
+        now_us += us;
+    }
+
+    // state of the input pins, written by the runner to script input
+    static const int PIN_COUNT = 40;
+    inline uint8_t pins[PIN_COUNT] = {0};
+
+    // Serial output is swallowed unless this is set, but counted
+    inline bool serial_echo = false;
+    inline uint64_t serial_bytes = 0;
+    inline std::deque<char> serial_input;
+
+    inline void serial_feed(const char *line)
+    {
+        while (*line)
+            serial_input.push_back(*line++);
+    }
+}
+
+// ---------------------------------
+// ------------- TIME --------------
+// ---------------------------------
+inline unsigned long millis()
+{
+    return (unsigned long)(hal::now_us / 1000);
+}
+
+inline unsigned long micros()
+{
+    return (unsigned long)hal::now_us;
+}
+
+inline void delay(uint32_t ms)
+{
+    hal::advance_us((uint64_t)ms * 1000);
+}
+
+inline void delayMicroseconds(uint32_t us)
+{
+    hal::advance_us(us);
+}
+
+// ---------------------------------
+// ------------- MATH --------------
+// ---------------------------------
+inline long map(long x, long in_min, long in_max, long out_min, long out_max)
+{
+    const long run = in_max - in_min;
+    if (run == 0)
+        return -1; // same as the ESP32 core, which also logs an error
+    const long rise = out_max - out_min;
+    const long delta = x - in_min;
+    return (delta * rise) / run + out_min;
+}
+
+inline uint32_t hal_random_seed = 1;
+
+inline void randomSeed(unsigned long seed)
+{
+    if (seed != 0)
+        hal_random_seed = seed;
+}
+
+inline long random(long howbig)
+{
+    if (howbig <= 0)
+        return 0;
+    // xorshift32, deterministic so benchmark runs are comparable
+    hal_random_seed ^= hal_random_seed << 13;
+    hal_random_seed ^= hal_random_seed >> 17;
+    hal_random_seed ^= hal_random_seed << 5;
+    return hal_random_seed % howbig;
+}
+
+inline long random(long howsmall, long howbig)
+{
+    if (howsmall >= howbig)
+        return howsmall;
+    return random(howbig - howsmall) + howsmall;
+}
+
+// ---------------------------------
+// ------------- GPIO --------------
+// ---------------------------------
+inline void pinMode(uint8_t pin, uint8_t mode)
+{
+    (void)pin;
+    (void)mode;
+}
+
+inline int digitalRead(uint8_t pin)
+{
+    return pin < hal::PIN_COUNT ? hal::pins[pin] : LOW;
+}
+
+inline void digitalWrite(uint8_t pin, uint8_t val)
+{
+    if (pin < hal::PIN_COUNT)
+        hal::pins[pin] = val;
+}
+
+// interrupts are numbered like the pins on the ESP32
+#define digitalPinToInterrupt(p) ((p) < hal::PIN_COUNT ? (p) : -1)
+
+namespace hal
+{
+    typedef struct
+    {
+        void (*handler)(void *arg);
+        void *arg;
+        int mode;
+    } PinInterrupt;
+
+    inline PinInterrupt pin_interrupts[PIN_COUNT] = {};
+
+    // drives an input pin from the outside, like a button would, and runs
+    // its interrupt handler right away if the edge is one it waits for
+    inline void set_pin(uint8_t pin, uint8_t level)
+    {
+        if (pin >= PIN_COUNT || pins[pin] == level)
+            return;
+        pins[pin] = level;
+        const PinInterrupt &interrupt = pin_interrupts[pin];
+        if (interrupt.handler && (interrupt.mode & (level == HIGH ? RISING : FALLING)))
+            interrupt.handler(interrupt.arg);
+    }
+}
+
+inline void attachInterruptArg(uint8_t pin, void (*handler)(void *), void *arg, int mode)
+{
+    if (pin < hal::PIN_COUNT)
+        hal::pin_interrupts[pin] = {handler, arg, mode};
+}
+
+inline void attachInterrupt(uint8_t pin, void (*handler)(), int mode)
+{
+    attachInterruptArg(pin, [](void *arg) { ((void (*)())arg)(); }, (void *)handler, mode);
+}
+
+inline void detachInterrupt(uint8_t pin)
+{
+    if (pin < hal::PIN_COUNT)
+        hal::pin_interrupts[pin] = {};
+}
+
+inline void dacWrite(uint8_t pin, uint8_t value)
+{
+    (void)pin;
+    (void)value;
+}
+
+// ---------------------------------
+// ------------ STRINGS ------------
+// ---------------------------------
+class String
+{
+public:
+    String(const char *s = "") : _s(s) {}
+    String(const std::string &s) : _s(s) {}
+
+    unsigned int length() const { return _s.length(); }
+    const char *c_str() const { return _s.c_str(); }
+    char charAt(unsigned int index) const { return index < _s.length() ? _s[index] : 0; }
+
+    int indexOf(char c, unsigned int from = 0) const
+    {
+        size_t pos = _s.find(c, from);
+        return pos == std::string::npos ? -1 : (int)pos;
+    }
+
+    String substring(unsigned int left, unsigned int right) const
+    {
+        if (left > right)
+            std::swap(left, right);
+        if (left >= _s.length())
+            return String();
+        return String(_s.substr(left, right - left));
+    }
+
+    long toInt() const { return atol(_s.c_str()); }
+
+private:
+    std::string _s;
+};
+
+// ---------------------------------
+// ------------- PRINT -------------
+// ---------------------------------
+class Print
+{
+public:
+    virtual ~Print() {}
+    virtual size_t write(const uint8_t *buffer, size_t size) = 0;
+
+    size_t write(uint8_t c) { return write(&c, 1); }
+
+    size_t print(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+    size_t print(const String &s) { return print(s.c_str()); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(unsigned char n) { return printf("%u", n); }
+    size_t print(int n) { return printf("%d", n); }
+    size_t print(unsigned int n) { return printf("%u", n); }
+    size_t print(long n) { return printf("%ld", n); }
+    size_t print(unsigned long n) { return printf("%lu", n); }
+    size_t print(double n) { return printf("%.2f", n); }
+
+    template <typename T>
+    size_t println(T value) { return print(value) + println(); }
+    size_t println() { return print("\r\n"); }
+
+    size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)))
+    {
+        char buf[256];
+        va_list args;
+        va_start(args, format);
+        int len = vsnprintf(buf, sizeof(buf), format, args);
+        va_end(args);
+        if (len < 0)
+            return 0;
+        return write((const uint8_t *)buf, std::min((size_t)len, sizeof(buf) - 1));
+    }
+};
+
+class HardwareSerial : public Print
+{
+public:
+    void begin(unsigned long baud) { (void)baud; }
+
+    int available() { return hal::serial_input.size(); }
+
+    int read()
+    {
+        if (hal::serial_input.empty())
+            return -1;
+        char c = hal::serial_input.front();
+        hal::serial_input.pop_front();
+        return c;
+    }
+
+    using Print::write;
+    size_t write(const uint8_t *buffer, size_t size) override
+    {
+        if (hal::serial_echo)
+            fwrite(buffer, 1, size, stdout);
+        hal::serial_bytes += size;
+        return size;
+    }
+};
+
+inline HardwareSerial Serial;
+
+// ---------------------------------
+// ------------- ESP ---------------
+// ---------------------------------
+#define HAL_CPU_FREQ_MHZ 240
+
+inline uint32_t getCpuFrequencyMhz()
+{
+    return HAL_CPU_FREQ_MHZ;
+}
+
+class EspClass
+{
+public:
+    void restart() { exit(0); }
+
+    // unlike millis() this follows the wall clock, profiling measures real cost
+    uint32_t getCycleCount()
+    {
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch());
+        return (uint32_t)((uint64_t)ns.count() * HAL_CPU_FREQ_MHZ / 1000);
+    }
+};
+
+inline EspClass ESP;
+
+// ---------------------------------
+// ----------- FREERTOS ------------
+// ---------------------------------
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef void (*TaskFunction_t)(void *);
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdPASS 1
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+struct tskTaskControlBlock
+{
+    std::mutex lock;
+    std::condition_variable notified;
+    uint32_t notifyValue = 0;
+};
+typedef tskTaskControlBlock *TaskHandle_t;
+
+namespace hal
+{
+    inline thread_local TaskHandle_t current_task = NULL;
+}
+
+inline TaskHandle_t xTaskGetCurrentTaskHandle()
+{
+    // the thread running setup()/loop() gets its control block on first use
+    if (hal::current_task == NULL)
+        hal::current_task = new tskTaskControlBlock();
+    return hal::current_task;
+}
+
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task, const char *name, uint32_t stackDepth,
+                                          void *params, UBaseType_t priority, TaskHandle_t *handle, BaseType_t core)
+{
+    (void)name;
+    (void)stackDepth;
+    (void)priority;
+    (void)core;
+
+    TaskHandle_t tcb = new tskTaskControlBlock();
+    if (handle)
+        *handle = tcb;
+    std::thread([task, params, tcb]() {
+        hal::current_task = tcb;
+        task(params);
+    }).detach();
+    return pdPASS;
+}
+
+inline BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    {
+        std::lock_guard<std::mutex> guard(task->lock);
+        task->notifyValue++;
+    }
+    task->notified.notify_one();
+    return pdPASS;
+}
+
+// Tasks that wait for the tick (like the sensor task) run in real time, not on
+// the virtual clock, which only the runner moves
+inline TickType_t xTaskGetTickCount()
+{
+    return (TickType_t)(hal::now_us / 1000);
+}
+
+inline void vTaskDelayUntil(TickType_t *previousWake, TickType_t increment)
+{
+    *previousWake += increment;
+    std::this_thread::sleep_for(std::chrono::milliseconds(increment * portTICK_PERIOD_MS));
+}
+
+inline uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait)
+{
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    std::unique_lock<std::mutex> guard(self->lock);
+    auto pending = [self]() { return self->notifyValue > 0; };
+    if (ticksToWait == portMAX_DELAY)
+        self->notified.wait(guard, pending);
+    else
+        self->notified.wait_for(guard, std::chrono::milliseconds(ticksToWait * portTICK_PERIOD_MS), pending);
+
+    uint32_t value = self->notifyValue;
+    if (value > 0)
+        self->notifyValue = clearCountOnExit ? 0 : value - 1;
+    return value;
+}
+
+#endif
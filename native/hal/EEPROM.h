@@ -0,0 +1,41 @@
+/*
+  Minimal stand-in for the ESP32 EEPROM library, used by the native build.
+
+  Backed by RAM and starts erased (0xFF), like a fresh flash partition, so the
+  game always boots with its default settings.
+*/
+#ifndef NATIVE_HAL_EEPROM_H
+#define NATIVE_HAL_EEPROM_H
+
+#include "Arduino.h"
+
+class EEPROMClass
+{
+public:
+    EEPROMClass() { memset(_data, 0xFF, sizeof(_data)); }
+
+    bool begin(size_t size) { return size <= sizeof(_data); }
+    void end() {}
+    bool commit() { return true; }
+
+    uint8_t read(int address) { return _data[address]; }
+
+    size_t readBytes(int address, void *value, size_t len)
+    {
+        memcpy(value, _data + address, len);
+        return len;
+    }
+
+    size_t writeBytes(int address, const void *value, size_t len)
+    {
+        memcpy(_data + address, value, len);
+        return len;
+    }
+
+private:
+    uint8_t _data[512];
+};
+
+inline EEPROMClass EEPROM;
+
+#endif
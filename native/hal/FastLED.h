@@ -0,0 +1,332 @@
+/*
+  Minimal stand-in for FastLED, used by the native build.
+
+  Colors and the lib8tion helpers follow the FastLED implementations closely
+  enough that render code costs roughly the same. show() does the brightness
+  scaling of the registered LEDs into an output buffer (the part of a real
+  show that runs on the CPU) and counts the frames, nothing is sent anywhere.
+  Set hal::show_ns_per_led to make show() take as long as sending to a strip.
+*/
+#ifndef NATIVE_HAL_FASTLED_H
+#define NATIVE_HAL_FASTLED_H
+
+#include "Arduino.h"
+
+#define FASTLED_VERSION 3009019
+
+// ---------------------------------
+// ----------- LIB8TION ------------
+// ---------------------------------
+inline uint16_t rand16seed = 1337;
+
+inline uint8_t qadd8(uint8_t i, uint8_t j)
+{
+    unsigned int t = i + j;
+    return t > 255 ? 255 : t;
+}
+
+inline uint8_t qsub8(uint8_t i, uint8_t j)
+{
+    int t = i - j;
+    return t < 0 ? 0 : t;
+}
+
+inline uint8_t scale8(uint8_t i, uint8_t scale)
+{
+    return ((uint16_t)i * (1 + (uint16_t)scale)) >> 8;
+}
+
+inline uint8_t scale8_video(uint8_t i, uint8_t scale)
+{
+    return (((int)i * (int)scale) >> 8) + ((i && scale) ? 1 : 0);
+}
+
+inline uint16_t scale16(uint16_t i, uint16_t scale)
+{
+    return ((uint32_t)i * (1 + (uint32_t)scale)) >> 16;
+}
+
+inline uint8_t random8()
+{
+    rand16seed = (rand16seed * 2053) + 13849;
+    return (uint8_t)((uint8_t)(rand16seed & 0xFF) + (uint8_t)(rand16seed >> 8));
+}
+
+inline uint8_t random8(uint8_t lim)
+{
+    return (random8() * lim) >> 8;
+}
+
+inline uint8_t random8(uint8_t min, uint8_t lim)
+{
+    return random8(lim - min) + min;
+}
+
+inline uint16_t random16()
+{
+    rand16seed = (rand16seed * 2053) + 13849;
+    return rand16seed;
+}
+
+inline uint16_t random16(uint16_t lim)
+{
+    return ((uint32_t)random16() * lim) >> 16;
+}
+
+inline int16_t sin16(uint16_t theta)
+{
+    return (int16_t)(32767.0 * sin(theta * (2.0 * M_PI / 65536.0)));
+}
+
+inline uint16_t beatsin16(uint16_t bpm, uint16_t lowest = 0, uint16_t highest = 65535)
+{
+    if (bpm < 256)
+        bpm <<= 8; // bpm in Q8.8, like beat16()
+    uint16_t beat = ((uint64_t)millis() * bpm * 280) >> 16;
+    uint16_t beatsin = sin16(beat) + 32768;
+    return lowest + scale16(beatsin, highest - lowest);
+}
+
+// ---------------------------------
+// ------------ COLORS -------------
+// ---------------------------------
+struct CHSV
+{
+    uint8_t h, s, v;
+
+    CHSV() : h(0), s(0), v(0) {}
+    CHSV(uint8_t ih, uint8_t is, uint8_t iv) : h(ih), s(is), v(iv) {}
+};
+
+struct CRGB
+{
+    uint8_t r, g, b;
+
+    enum HTMLColorCode
+    {
+        Black = 0x000000,
+        DarkRed = 0x8B0000,
+        Red = 0xFF0000,
+        Green = 0x008000,
+        Blue = 0x0000FF,
+        White = 0xFFFFFF,
+    };
+
+    CRGB() : r(0), g(0), b(0) {}
+    CRGB(uint8_t ir, uint8_t ig, uint8_t ib) : r(ir), g(ig), b(ib) {}
+    CRGB(uint32_t colorcode) : r((colorcode >> 16) & 0xFF), g((colorcode >> 8) & 0xFF), b(colorcode & 0xFF) {}
+    CRGB(HTMLColorCode colorcode) : CRGB((uint32_t)colorcode) {}
+    CRGB(const CHSV &hsv);
+
+    CRGB &setHSV(uint8_t hue, uint8_t sat, uint8_t val);
+
+    CRGB &operator+=(const CRGB &rhs)
+    {
+        r = qadd8(r, rhs.r);
+        g = qadd8(g, rhs.g);
+        b = qadd8(b, rhs.b);
+        return *this;
+    }
+
+    CRGB &operator|=(const CRGB &rhs)
+    {
+        r = std::max(r, rhs.r);
+        g = std::max(g, rhs.g);
+        b = std::max(b, rhs.b);
+        return *this;
+    }
+
+    // scale down, but never all the way to black
+    CRGB &operator%=(uint8_t scaledown)
+    {
+        return nscale8_video(scaledown);
+    }
+
+    CRGB &nscale8(uint8_t scaledown)
+    {
+        r = scale8(r, scaledown);
+        g = scale8(g, scaledown);
+        b = scale8(b, scaledown);
+        return *this;
+    }
+
+    CRGB &nscale8_video(uint8_t scaledown)
+    {
+        r = scale8_video(r, scaledown);
+        g = scale8_video(g, scaledown);
+        b = scale8_video(b, scaledown);
+        return *this;
+    }
+
+    bool operator==(const CRGB &rhs) const { return r == rhs.r && g == rhs.g && b == rhs.b; }
+    bool operator!=(const CRGB &rhs) const { return !(*this == rhs); }
+};
+
+// integer six sector conversion, close enough to hsv2rgb_rainbow
+inline void hsv2rgb_rainbow(const CHSV &hsv, CRGB &rgb)
+{
+    if (hsv.s == 0)
+    {
+        rgb = CRGB(hsv.v, hsv.v, hsv.v);
+        return;
+    }
+    uint8_t sector = hsv.h / 43;
+    uint8_t frac = (hsv.h - sector * 43) * 6;
+    uint8_t p = scale8(hsv.v, 255 - hsv.s);
+    uint8_t q = scale8(hsv.v, 255 - scale8(hsv.s, frac));
+    uint8_t t = scale8(hsv.v, 255 - scale8(hsv.s, 255 - frac));
+    switch (sector)
+    {
+    case 0: rgb = CRGB(hsv.v, t, p); break;
+    case 1: rgb = CRGB(q, hsv.v, p); break;
+    case 2: rgb = CRGB(p, hsv.v, t); break;
+    case 3: rgb = CRGB(p, q, hsv.v); break;
+    case 4: rgb = CRGB(t, p, hsv.v); break;
+    default: rgb = CRGB(hsv.v, p, q); break;
+    }
+}
+
+inline CRGB::CRGB(const CHSV &hsv)
+{
+    hsv2rgb_rainbow(hsv, *this);
+}
+
+inline CRGB &CRGB::setHSV(uint8_t hue, uint8_t sat, uint8_t val)
+{
+    hsv2rgb_rainbow(CHSV(hue, sat, val), *this);
+    return *this;
+}
+
+inline CRGB HeatColor(uint8_t temperature)
+{
+    CRGB heatcolor;
+    uint8_t t192 = scale8_video(temperature, 191);
+    uint8_t heatramp = (t192 & 0x3F) << 2;
+    if (t192 & 0x80)
+        heatcolor = CRGB(255, 255, heatramp);
+    else if (t192 & 0x40)
+        heatcolor = CRGB(255, heatramp, 0);
+    else
+        heatcolor = CRGB(heatramp, 0, 0);
+    return heatcolor;
+}
+
+inline void fill_rainbow(CRGB *leds, int numToFill, uint8_t initialhue, uint8_t deltahue = 5)
+{
+    CHSV hsv(initialhue, 240, 255);
+    for (int i = 0; i < numToFill; ++i)
+    {
+        leds[i] = hsv;
+        hsv.h += deltahue;
+    }
+}
+
+inline void fill_solid(CRGB *leds, int numToFill, const CRGB &color)
+{
+    for (int i = 0; i < numToFill; ++i)
+        leds[i] = color;
+}
+
+inline void fadeToBlackBy(CRGB *leds, uint16_t numLeds, uint8_t fadeBy)
+{
+    for (uint16_t i = 0; i < numLeds; ++i)
+        leds[i].nscale8(255 - fadeBy);
+}
+
+// ---------------------------------
+// ----------- CONTROLLER ----------
+// ---------------------------------
+enum EOrder
+{
+    RGB = 0012,
+    RBG = 0021,
+    GRB = 0102,
+    GBR = 0120,
+    BRG = 0201,
+    BGR = 0210
+};
+
+enum ESPIChipsets
+{
+    APA102,
+};
+
+template <uint8_t DATA_PIN>
+class NEOPIXEL
+{
+};
+
+namespace hal
+{
+    // frames handed to FastLED.show()
+    inline std::atomic<uint32_t> led_shows(0);
+    // time it takes to send one LED, to emulate the wire time of a real strip
+    // (about 30us for WS2812)
+    inline uint32_t show_ns_per_led = 0;
+}
+
+// one strip, setLeds() changes how many LEDs show() sends
+class CLEDController
+{
+public:
+    CLEDController &setLeds(CRGB *data, int nLeds)
+    {
+        assert(nLeds <= MAX_OUT);
+        _leds = data;
+        _nLeds = nLeds;
+        return *this;
+    }
+    int size() { return _nLeds; }
+
+    static const int MAX_OUT = 1000;
+    CRGB *_leds = NULL;
+    int _nLeds = 0;
+};
+
+class CFastLED
+{
+public:
+    template <template <uint8_t DATA_PIN> class CHIPSET, uint8_t DATA_PIN>
+    CLEDController &addLeds(CRGB *data, int nLeds) { return _controller.setLeds(data, nLeds); }
+
+    template <ESPIChipsets CHIPSET, uint8_t DATA_PIN, uint8_t CLOCK_PIN, EOrder RGB_ORDER>
+    CLEDController &addLeds(CRGB *data, int nLeds) { return _controller.setLeds(data, nLeds); }
+
+    void setBrightness(uint8_t scale) { _brightness = scale; }
+    uint8_t getBrightness() { return _brightness; }
+    void setDither(uint8_t ditherMode) { (void)ditherMode; }
+
+    // like FastLED, this clears every registered LED, not just the used ones
+    void clear(bool writeData = false)
+    {
+        std::fill(_controller._leds, _controller._leds + _controller._nLeds, CRGB());
+        if (writeData)
+            show();
+    }
+
+    void show() { show(_brightness); }
+
+    void show(uint8_t scale)
+    {
+        const CRGB *leds = _controller._leds;
+        const int nLeds = _controller._nLeds;
+        for (int i = 0; i < nLeds; ++i)
+        {
+            _out[i].r = scale8(leds[i].r, scale);
+            _out[i].g = scale8(leds[i].g, scale);
+            _out[i].b = scale8(leds[i].b, scale);
+        }
+        if (hal::show_ns_per_led)
+            std::this_thread::sleep_for(std::chrono::nanoseconds((uint64_t)hal::show_ns_per_led * nLeds));
+        hal::led_shows++;
+    }
+
+private:
+    CLEDController _controller;
+    uint8_t _brightness = 255;
+    CRGB _out[CLEDController::MAX_OUT];
+};
+
+inline CFastLED FastLED;
+
+#endif
@@ -0,0 +1,49 @@
+/*
+  Minimal stand-in for the ESP32 WiFi library, used by the native build.
+
+  The access point comes up instantly and no client ever connects.
+*/
+#ifndef NATIVE_HAL_WIFI_H
+#define NATIVE_HAL_WIFI_H
+
+#include "Arduino.h"
+
+class WiFiClient : public Print
+{
+public:
+    uint8_t connected() { return 0; }
+    int available() { return 0; }
+    int read() { return -1; }
+
+    using Print::write;
+    size_t write(const uint8_t *buffer, size_t size) override
+    {
+        (void)buffer;
+        return size;
+    }
+};
+
+class WiFiServer
+{
+public:
+    WiFiServer(uint16_t port) { (void)port; }
+    void begin() {}
+    WiFiClient available() { return WiFiClient(); }
+};
+
+class WiFiClass
+{
+public:
+    bool softAP(const char *ssid, const char *passphrase = NULL, int channel = 1, int ssid_hidden = 0)
+    {
+        (void)ssid;
+        (void)passphrase;
+        (void)channel;
+        (void)ssid_hidden;
+        return true;
+    }
+};
+
+inline WiFiClass WiFi;
+
+#endif
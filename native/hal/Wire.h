@@ -0,0 +1,80 @@
+/*
+  Minimal stand-in for the ESP32 Wire (I2C) library, used by the native build.
+
+  The only devices on the bus are the emulated MPU6050s of mpu6050.h, once a
+  stream is attached to them. Every other address NACKs and returns no
+  bytes, so without a stream the game sees both gyros as disconnected.
+  Transfers are counted.
+*/
+#ifndef NATIVE_HAL_WIRE_H
+#define NATIVE_HAL_WIRE_H
+
+#include "Arduino.h"
+#include "mpu6050.h"
+
+namespace hal
+{
+    // endTransmission() and requestFrom() calls that reached a device
+    inline uint32_t i2c_transfers = 0;
+}
+
+class TwoWire
+{
+public:
+    bool begin() { return true; }
+    bool setClock(uint32_t frequency)
+    {
+        (void)frequency;
+        return true;
+    }
+    void beginTransmission(uint16_t address)
+    {
+        _address = address;
+        _tx.clear();
+    }
+    size_t write(uint8_t data)
+    {
+        _tx.push_back(data);
+        return 1;
+    }
+    uint8_t endTransmission(bool sendStop = true)
+    {
+        (void)sendStop;
+        hal::Mpu6050 *mpu = hal::mpu6050_at(_address);
+        if (mpu == NULL)
+            return 2; // received NACK on transmit of address
+        hal::i2c_transfers++;
+        mpu->Write(_tx.data(), _tx.size());
+        return 0;
+    }
+    uint8_t requestFrom(uint16_t address, uint8_t size, bool sendStop = true)
+    {
+        (void)sendStop;
+        _rx.clear();
+        hal::Mpu6050 *mpu = hal::mpu6050_at(address);
+        if (mpu == NULL)
+            return 0;
+        hal::i2c_transfers++;
+        for (uint8_t i = 0; i < size; i++)
+            _rx.push_back(mpu->Read());
+        return size;
+    }
+    int available() { return _rx.size(); }
+    int read()
+    {
+        if (_rx.empty())
+            return -1;
+        uint8_t b = _rx.front();
+        _rx.pop_front();
+        return b;
+    }
+
+private:
+    uint16_t _address = 0;
+    std::vector<uint8_t> _tx;
+    std::deque<uint8_t> _rx;
+};
+
+inline TwoWire Wire;
+
+#endif
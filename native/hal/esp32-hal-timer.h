@@ -0,0 +1,52 @@
+/*
+  Minimal stand-in for the ESP32 hardware timer API, used by the native build.
+
+  The timer never fires, the sound ISR is never called. Alarm writes are
+  counted, since each sound() call reprograms the timer.
+*/
+#ifndef NATIVE_HAL_ESP32_HAL_TIMER_H
+#define NATIVE_HAL_ESP32_HAL_TIMER_H
+
+#include "Arduino.h"
+
+typedef struct hw_timer_s
+{
+    uint8_t num;
+    uint64_t alarm;
+    bool enabled;
+} hw_timer_t;
+
+namespace hal
+{
+    inline hw_timer_t timers[4];
+    // calls to timerAlarmWrite()
+    inline uint32_t timer_alarm_writes = 0;
+}
+
+inline hw_timer_t *timerBegin(uint8_t num, uint16_t divider, bool countUp)
+{
+    (void)divider;
+    (void)countUp;
+    hal::timers[num].num = num;
+    return &hal::timers[num];
+}
+
+inline void timerAttachInterrupt(hw_timer_t *timer, void (*fn)(void), bool edge)
+{
+    (void)timer;
+    (void)fn;
+    (void)edge;
+}
+
+inline void timerAlarmWrite(hw_timer_t *timer, uint64_t alarm_value, bool autoreload)
+{
+    (void)autoreload;
+    timer->alarm = alarm_value;
+    hal::timer_alarm_writes++;
+}
+
+inline void timerAlarmEnable(hw_timer_t *timer) { timer->enabled = true; }
+inline void timerStop(hw_timer_t *timer) { timer->enabled = false; }
+inline void timerRestart(hw_timer_t *timer) { timer->enabled = true; }
+
+#endif
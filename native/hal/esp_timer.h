@@ -0,0 +1,57 @@
+/*
+  Minimal stand-in for the ESP-IDF high resolution timer, used by the native
+  build. Reads the same virtual clock as millis()/micros().
+
+  Nothing else moves the virtual clock while a task waits for a timer, so a
+  one shot timer fires right away: esp_timer_start_once() advances the clock
+  to the alarm and calls the callback.
+*/
+#ifndef NATIVE_HAL_ESP_TIMER_H
+#define NATIVE_HAL_ESP_TIMER_H
+
+#include "Arduino.h"
+
+typedef int esp_err_t;
+#define ESP_OK 0
+
+typedef void (*esp_timer_cb_t)(void *arg);
+
+typedef struct
+{
+    esp_timer_cb_t callback;
+    void *arg;
+    const char *name;
+} esp_timer_create_args_t;
+
+struct esp_timer
+{
+    esp_timer_cb_t callback;
+    void *arg;
+};
+typedef struct esp_timer *esp_timer_handle_t;
+
+inline int64_t esp_timer_get_time()
+{
+    return (int64_t)hal::now_us;
+}
+
+inline esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *handle)
+{
+    *handle = new esp_timer{args->callback, args->arg};
+    return ESP_OK;
+}
+
+inline esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeoutUs)
+{
+    hal::advance_us(timeoutUs);
+    timer->callback(timer->arg);
+    return ESP_OK;
+}
+
+inline esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    (void)timer;
+    return ESP_OK;
+}
+
+#endif
@@ -0,0 +1,224 @@
+/*
+  Emulated MPU6050 on the I2C bus of the native build, fed from an MPU
+  stream, so the sensor pipeline can be tested and measured on the host.
+
+  An MPU stream holds what the FIFO of one or two MPU6050s gave, in the
+  order the chip gave it:
+
+    bytes 0..3  "MPUF"
+    byte 4      version, 1
+    byte 5      flags, bit 0: every sample is followed by one of the
+                reference gyro
+    bytes 6..7  sample rate in Hz, big endian
+    then        12 bytes per sample, exactly as read from FIFO_R_W: accel
+                x, y, z and gyro x, y, z, each an int16, big endian
+
+  The emulation covers what Twang_MPU uses: WHO_AM_I, the data registers and
+  the FIFO (count, reads, overflow, reset). Once the FIFO is enabled, it
+  fills at the configured sample rate on the virtual clock, with the
+  samples of the stream over and over.
+*/
+#ifndef NATIVE_HAL_MPU6050_H
+#define NATIVE_HAL_MPU6050_H
+
+#include "Arduino.h"
+#include <deque>
+#include <vector>
+
+#define MPU_STREAM_HEADER_LEN 8
+#define MPU_STREAM_FLAG_REF 0x01
+
+namespace hal
+{
+    class Mpu6050
+    {
+    public:
+        static const int RECORD_LEN = 12;
+        static const size_t FIFO_LEN = 1024;
+
+        explicit Mpu6050(uint8_t address) : _address(address) {}
+
+        uint8_t Address() const { return _address; }
+        bool Present() const { return !_records.empty(); }
+
+        // replays records (RECORD_LEN bytes each), empty takes it off the bus
+        void Attach(std::vector<uint8_t> records)
+        {
+            _records = records;
+            _records.resize(records.size() / RECORD_LEN * RECORD_LEN);
+            _next = 0;
+            memset(_regs, 0, sizeof(_regs));
+            _fifo.clear();
+        }
+
+        // the sample in the data registers, accel x, y, z, gyro x, y, z
+        int16_t Latest(int axis) const
+        {
+            const int reg = axis < 3 ? ACCEL_XOUT_H + axis * 2 : GYRO_XOUT_H + (axis - 3) * 2;
+            return (int16_t)(_regs[reg] << 8 | _regs[reg + 1]);
+        }
+
+        // a write transfer: register, then the values for it and the next ones
+        void Write(const uint8_t *data, size_t len)
+        {
+            if (len == 0)
+                return;
+            _pointer = data[0] & 0x7F;
+            for (size_t i = 1; i < len; i++)
+                WriteRegister(_pointer++ & 0x7F, data[i]);
+        }
+
+        // the next byte of a read transfer
+        uint8_t Read()
+        {
+            Update();
+            if (_pointer == FIFO_R_W)
+            {
+                if (_fifo.empty())
+                    return 0;
+                uint8_t b = _fifo.front();
+                _fifo.pop_front();
+                return b;
+            }
+            const uint8_t reg = _pointer++ & 0x7F;
+            switch (reg)
+            {
+            case WHO_AM_I:
+                return 0x68;
+            case FIFO_COUNT_H:
+                return _fifo.size() >> 8;
+            case FIFO_COUNT_H + 1:
+                return _fifo.size() & 0xFF;
+            case INT_STATUS:
+            {
+                uint8_t status = _regs[INT_STATUS];
+                _regs[INT_STATUS] = 0; // cleared by reading
+                return status;
+            }
+            default:
+                return _regs[reg];
+            }
+        }
+
+    private:
+        static const uint8_t SMPLRT_DIV = 0x19;
+        static const uint8_t CONFIG = 0x1A;
+        static const uint8_t FIFO_EN = 0x23;
+        static const uint8_t INT_STATUS = 0x3A;
+        static const uint8_t ACCEL_XOUT_H = 0x3B;
+        static const uint8_t GYRO_XOUT_H = 0x43;
+        static const uint8_t USER_CTRL = 0x6A;
+        static const uint8_t FIFO_COUNT_H = 0x72;
+        static const uint8_t FIFO_R_W = 0x74;
+        static const uint8_t WHO_AM_I = 0x75;
+        static const uint8_t INT_FIFO_OFLOW = 0x10;
+        static const size_t MAX_CATCH_UP = FIFO_LEN / RECORD_LEN + 1;
+
+        void WriteRegister(uint8_t reg, uint8_t value)
+        {
+            Update();
+            if (reg == USER_CTRL)
+            {
+                const bool reset = value & 0x04; // FIFO_RESET, clears itself
+                const bool enable = (value & 0x40) && !(_regs[USER_CTRL] & 0x40);
+                if (reset)
+                    _fifo.clear();
+                if (reset || enable)
+                    RestartClock();
+                value &= ~0x04;
+            }
+            _regs[reg] = value;
+        }
+
+        uint32_t SampleUs() const
+        {
+            const uint32_t baseHz = ((_regs[CONFIG] & 0x07) == 0 || (_regs[CONFIG] & 0x07) == 7) ? 8000 : 1000;
+            return 1000000 * (_regs[SMPLRT_DIV] + 1) / baseHz;
+        }
+
+        void RestartClock()
+        {
+            _startUs = now_us;
+            _produced = 0;
+        }
+
+        // takes the samples that are due by now
+        void Update()
+        {
+            if (_records.empty())
+                return;
+            const uint64_t due = (now_us - _startUs) / SampleUs();
+            if (due - _produced > MAX_CATCH_UP)
+                _produced = due - MAX_CATCH_UP;
+            const bool fifo = (_regs[USER_CTRL] & 0x40) && _regs[FIFO_EN] == 0x78;
+            for (; _produced < due; _produced++)
+            {
+                const uint8_t *r = &_records[_next * RECORD_LEN];
+                _next = (_next + 1) % (_records.size() / RECORD_LEN);
+                memcpy(&_regs[ACCEL_XOUT_H], r, 6);
+                memcpy(&_regs[GYRO_XOUT_H], r + 6, 6);
+                if (!fifo)
+                    continue;
+                _fifo.insert(_fifo.end(), r, r + RECORD_LEN);
+                while (_fifo.size() > FIFO_LEN) // the oldest bytes are lost, like on the chip
+                {
+                    _fifo.pop_front();
+                    _regs[INT_STATUS] |= INT_FIFO_OFLOW;
+                }
+            }
+        }
+
+        uint8_t _address;
+        uint8_t _regs[128] = {0};
+        uint8_t _pointer = 0;
+        std::vector<uint8_t> _records;
+        size_t _next = 0;
+        std::deque<uint8_t> _fifo;
+        uint64_t _startUs = 0;
+        uint64_t _produced = 0;
+    };
+
+    // the main gyro and the reference gyro (AD0 high)
+    inline Mpu6050 mpu6050s[2] = {Mpu6050(0x68), Mpu6050(0x69)};
+
+    inline Mpu6050 *mpu6050_at(uint16_t address)
+    {
+        for (Mpu6050 &mpu : mpu6050s)
+            if (mpu.Address() == address && mpu.Present())
+                return &mpu;
+        return NULL;
+    }
+
+    // Puts the gyros of an MPU stream on the bus, false if it is not one.
+    // Sets *rateHz to the rate it was recorded at.
+    inline bool mpu_attachStream(const std::vector<uint8_t> &stream, uint16_t *rateHz)
+    {
+        if (stream.size() < MPU_STREAM_HEADER_LEN || memcmp(stream.data(), "MPUF", 4) != 0 || stream[4] != 1)
+            return false;
+        const bool ref = stream[5] & MPU_STREAM_FLAG_REF;
+        *rateHz = stream[6] << 8 | stream[7];
+
+        const int stride = Mpu6050::RECORD_LEN * (ref ? 2 : 1);
+        std::vector<uint8_t> records[2];
+        for (size_t pos = MPU_STREAM_HEADER_LEN; pos + stride <= stream.size(); pos += stride)
+        {
+            auto record = stream.begin() + pos;
+            records[0].insert(records[0].end(), record, record + Mpu6050::RECORD_LEN);
+            if (ref)
+                records[1].insert(records[1].end(), record + Mpu6050::RECORD_LEN, record + stride);
+        }
+        if (records[0].empty())
+            return false;
+        mpu6050s[0].Attach(records[0]);
+        mpu6050s[1].Attach(records[1]);
+        return true;
+    }
+
+    // the header of an MPU stream, append the records
+    inline std::vector<uint8_t> mpu_streamHeader(uint16_t rateHz, bool ref)
+    {
+        return {'M', 'P', 'U', 'F', 1, (uint8_t)(ref ? MPU_STREAM_FLAG_REF : 0), (uint8_t)(rateHz >> 8), (uint8_t)rateHz};
+    }
+}
+
+#endif
@@ -1,21 +1,25 @@
 #include "Arduino.h"
+#include "frame.h"
+#include "iSin.h"
 
+// 12 bytes, the swarm build (ENEMY_SWARM) keeps hundreds of these
 class Enemy
 {
 public:
     void Spawn(int pos, int dir, int speed, int wobble);
-    void Tick();
+    void Tick(const FrameTime &ft);
     void Kill();
     bool Alive();
-    int _pos;
-    int _wobble;
-    int playerSide;
+    int16_t _pos;
+    int16_t _wobble;
+    int8_t playerSide;
 
 private:
-    int _dir;
-    int _speed;
-    int _alive;
-    int _origin;
+    int8_t _dir;
+    int8_t _speed; // world units per frame at SPEED_BASE_FPS
+    bool _alive;
+    int16_t _origin;
+    uint8_t _carry; // see frame_move()
 };
 
 void Enemy::Spawn(int pos, int dir, int speed, int wobble)
@@ -25,26 +29,27 @@ void Enemy::Spawn(int pos, int dir, int speed, int wobble)
     _wobble = wobble; // 0 = no, >0 = yes, value is half width of wobble
     _origin = pos;
     _speed = speed;
-    _alive = 1;
+    _carry = 0;
+    _alive = true;
 }
 
-void Enemy::Tick()
+void Enemy::Tick(const FrameTime &ft)
 {
     if (_alive)
     {
         if (_wobble > 0)
         {
-            _pos = _origin + (sin((millis() / 3000.0) * _speed) * _wobble);
+            _pos = _origin + isin16(isinPhase(ft.ms * _speed, isinRate(3000.0))) * _wobble / ISIN_MAX;
         }
         else
         {
             if (_dir == 0)
             {
-                _pos -= _speed;
+                _pos -= frame_move(ft, _speed, &_carry);
             }
             else
             {
-                _pos += _speed;
+                _pos += frame_move(ft, _speed, &_carry);
             }
             if (_pos > 1000)
             {
@@ -65,5 +70,5 @@ bool Enemy::Alive()
 
 void Enemy::Kill()
 {
-    _alive = 0;
+    _alive = false;
 }
@@ -0,0 +1,205 @@
+#ifndef INPUT_SOURCE_H
+#define INPUT_SOURCE_H
+
+#include "Arduino.h"
+#include <tuple>
+#include <utility>
+#include "esp_timer.h"
+
+/*
+	Where the player's input comes from: the gyro in the spring (MpuInput,
+	with or without the reference gyro in the base), a C64 joystick
+	(C64Input) or the host (ScriptedInput). Every source has
+
+		void Begin()                  called once from setup()
+		bool Read(InputState *state)  called once per frame, true if there
+		                              was new input, else state is left as is
+
+	and derives from InputSource, which keeps its InputStats. There are no
+	virtual calls: config.h picks the sources, InputMux combines them at
+	compile time, and a source that is not picked is a NoInput that
+	compiles to nothing.
+
+	To play with anything else, three buttons for example, write a source
+	that sets tilt to -90..90 and wobble to at least the attack threshold to
+	attack, and add it to the InputMux in TWANG32.ino.
+*/
+
+typedef struct InputState
+{
+	int tilt;	// -90..90, 0 is upright
+	int wobble; // attacks at user_settings.attack_threshold
+} InputState;
+
+typedef struct InputStats
+{
+	const char *name;
+	uint32_t updates;	   // Read() calls that had new input
+	uint64_t latencySumUs; // age of the newest input Read() took, summed over the updates
+	uint32_t latencyMaxUs;
+	uint32_t errors; // input that got lost, what counts depends on the source
+} InputStats;
+
+#define INPUT_MAX_SOURCES 4
+
+// the stats of every source there is, for the metrics page
+static const InputStats *inputStats[INPUT_MAX_SOURCES];
+static uint8_t inputStatsCount = 0;
+
+class InputSource
+{
+public:
+	const InputStats &Stats() const { return _stats; }
+
+protected:
+	explicit InputSource(const char *name)
+	{
+		_stats.name = name;
+		if (inputStatsCount < INPUT_MAX_SOURCES)
+			inputStats[inputStatsCount++] = &_stats;
+	}
+
+	// Read() took new input, the newest of it latencyUs old
+	void Took(uint32_t latencyUs)
+	{
+		_stats.updates++;
+		_stats.latencySumUs += latencyUs;
+		if (latencyUs > _stats.latencyMaxUs)
+			_stats.latencyMaxUs = latencyUs;
+	}
+
+	void Lost(uint32_t count) { _stats.errors += count; }
+
+private:
+	InputStats _stats = {};
+};
+
+// a source that was not picked
+class NoInput
+{
+public:
+	void Begin() {}
+	bool Read(InputState *) { return false; }
+};
+
+// one step of a script for ScriptedInput
+typedef struct InputStep
+{
+	uint32_t ms; // after the step before, or after Play() for the first one
+	int tilt;
+	int wobble;
+} InputStep;
+
+/*
+	Input from the host: Set() takes effect at the next frame, Play() runs
+	a list of steps on the clock. Input a frame never saw (a Set() that was
+	overwritten, steps that were due within the same frame) counts as lost.
+*/
+class ScriptedInput : public InputSource
+{
+public:
+	ScriptedInput() : InputSource("scripted") {}
+
+	void Begin() {}
+
+	void Set(int tilt, int wobble)
+	{
+		if (_pending)
+			Lost(1);
+		_steps = NULL;
+		_next = {tilt, wobble};
+		_dueUs = esp_timer_get_time();
+		_pending = true;
+	}
+
+	// steps has to stay around until it is done, the last one stays
+	void Play(const InputStep *steps, uint8_t count)
+	{
+		if (count == 0)
+			return;
+		if (_pending)
+			Lost(1);
+		_steps = steps;
+		_stepCount = count;
+		_step = 0;
+		_dueUs = esp_timer_get_time() + steps[0].ms * 1000ULL;
+		_next = {steps[0].tilt, steps[0].wobble};
+		_pending = true;
+	}
+
+	bool Read(InputState *state)
+	{
+		const uint64_t now = esp_timer_get_time();
+		if (!_pending || now < _dueUs)
+			return false;
+		while (NextStep(now))
+			Lost(1);
+		*state = _next;
+		Took(now - _dueUs);
+		_pending = NextStep(UINT64_MAX);
+		return true;
+	}
+
+private:
+	// moves on to the next step if it is due by nowUs
+	bool NextStep(uint64_t nowUs)
+	{
+		if (_steps == NULL || _step + 1 >= _stepCount || nowUs < _dueUs + _steps[_step + 1].ms * 1000ULL)
+			return false;
+		_step++;
+		_dueUs += _steps[_step].ms * 1000ULL;
+		_next = {_steps[_step].tilt, _steps[_step].wobble};
+		return true;
+	}
+
+	const InputStep *_steps = NULL;
+	uint8_t _stepCount = 0;
+	uint8_t _step = 0;
+	InputState _next = {0, 0};
+	uint64_t _dueUs = 0;
+	bool _pending = false;
+};
+
+/*
+	All of Sources as one: the tilt of the first one that is tilted, the
+	highest wobble of any. Each source keeps its last input until it has new.
+*/
+template <typename... Sources>
+class InputMux
+{
+public:
+	void Begin()
+	{
+		std::apply([](auto &...source) { (source.Begin(), ...); }, _sources);
+	}
+
+	bool Read(InputState *state)
+	{
+		if (!ReadAll(std::index_sequence_for<Sources...>()))
+			return false;
+		state->tilt = 0;
+		state->wobble = 0;
+		for (const InputState &s : _states)
+		{
+			if (state->tilt == 0)
+				state->tilt = s.tilt;
+			state->wobble = max(state->wobble, s.wobble);
+		}
+		return true;
+	}
+
+	template <typename Source>
+	Source &Get() { return std::get<Source>(_sources); }
+
+private:
+	template <size_t... I>
+	bool ReadAll(std::index_sequence<I...>)
+	{
+		return (std::get<I>(_sources).Read(&_states[I]) | ...); // every one, no short cut
+	}
+
+	std::tuple<Sources...> _sources;
+	InputState _states[sizeof...(Sources)] = {};
+};
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef INTERVAL_INDEX_H
+#define INTERVAL_INDEX_H
+
+#include "Arduino.h"
+
+/*
+	Sorted, non overlapping intervals of world positions for point queries.
+
+	Add() the intervals (inclusive on both ends, in any order), then Build()
+	sorts them and merges the ones that overlap. Find() is a binary search.
+	Every interval carries a value, usually an index into a pool, a merged
+	interval keeps the value of the one that starts first.
+*/
+template <uint16_t N>
+class IntervalIndex
+{
+public:
+	void Clear() { _count = 0; }
+
+	// ignored once N intervals were added
+	void Add(int left, int right, int value)
+	{
+		if (_count == N)
+			return;
+		_intervals[_count++] = {(int16_t)left, (int16_t)right, (int16_t)value};
+	}
+
+	void Build()
+	{
+		// insertion sort, N is small and the order rarely changes
+		for (uint16_t i = 1; i < _count; i++)
+		{
+			Interval in = _intervals[i];
+			int j = i - 1;
+			while (j >= 0 && _intervals[j].left > in.left)
+			{
+				_intervals[j + 1] = _intervals[j];
+				j--;
+			}
+			_intervals[j + 1] = in;
+		}
+
+		uint16_t merged = 0;
+		for (uint16_t i = 0; i < _count; i++)
+		{
+			if (merged > 0 && _intervals[i].left <= _intervals[merged - 1].right)
+				_intervals[merged - 1].right = max(_intervals[merged - 1].right, _intervals[i].right);
+			else
+				_intervals[merged++] = _intervals[i];
+		}
+		_count = merged;
+	}
+
+	// value of the interval that contains pos, -1 if there is none
+	int Find(int pos) const
+	{
+		// first interval that starts right of pos
+		uint16_t lo = 0;
+		uint16_t hi = _count;
+		while (lo < hi)
+		{
+			uint16_t mid = (lo + hi) / 2;
+			if (_intervals[mid].left <= pos)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		if (lo == 0 || _intervals[lo - 1].right < pos)
+			return -1;
+		return _intervals[lo - 1].value;
+	}
+
+	uint16_t Count() const { return _count; }
+	// the intervals are sorted by Left(), for sweeps
+	int Left(uint16_t i) const { return _intervals[i].left; }
+	int Right(uint16_t i) const { return _intervals[i].right; }
+
+private:
+	typedef struct Interval
+	{
+		int16_t left;
+		int16_t right;
+		int16_t value;
+	} Interval;
+
+	Interval _intervals[N];
+	uint16_t _count = 0;
+};
+
+#endif
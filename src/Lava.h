@@ -1,12 +1,13 @@
 #include "Arduino.h"
+#include "fixed.h"
 
 class Lava
 {
 public:
-	void Spawn(int left, int right, int ontime, int offtime, int offset, int state, float grow_rate, float flow_vector);
+	void Spawn(int left, int right, int ontime, int offtime, int offset, int state, Fixed grow_rate, Fixed flow_vector, unsigned long now);
 	void Kill();
 	int Alive();
-	void Update();
+	bool Update(Fixed step);
 	int _left;
 	int _right;
 	int _ontime;
@@ -14,19 +15,19 @@ public:
 	int _offset;
 	long _lastOn;
 	int _state;
-	float _grow_rate = 0.0;	  // size grows by this much each tick
-	float _flow_vector = 0.0; // endpoints move in the direction each tick.
+	Fixed _grow_rate;	// size grows by this much each frame at SPEED_BASE_FPS
+	Fixed _flow_vector; // endpoints move in the direction each frame at SPEED_BASE_FPS
 	static const int OFF = 0;
 	static const int ON = 1;
 
 private:
 	int _alive;
-	float _growth = 0;
-	float _flow = 0;
+	Fixed _growth;
+	Fixed _flow;
 	int _width;
 };
 
-void Lava::Spawn(int left, int right, int ontime, int offtime, int offset, int state, float grow_rate, float flow_vector)
+void Lava::Spawn(int left, int right, int ontime, int offtime, int offset, int state, Fixed grow_rate, Fixed flow_vector, unsigned long now)
 {
 	_left = left;
 	_right = right;
@@ -34,12 +35,12 @@ void Lava::Spawn(int left, int right, int ontime, int offtime, int offset, int s
 	_offtime = offtime;
 	_offset = offset;
 	_alive = 1;
-	_lastOn = millis() - offset;
+	_lastOn = now - offset;
 	_state = state;
 
 	_width = _right - _left;
 
-	_grow_rate = fabs(grow_rate); // only allow positive growth
+	_grow_rate = grow_rate.abs(); // only allow positive growth
 	_flow_vector = flow_vector;
 }
 
@@ -53,38 +54,43 @@ int Lava::Alive()
 	return _alive;
 }
 
-// this gets called on every frame.
-void Lava::Update()
+// this gets called on every frame with FrameTime.step, returns true if the
+// lava moved or grew
+bool Lava::Update(Fixed step)
 {
+	bool changed = false;
+
 	// update how much it has changed
 	if (_grow_rate != 0)
 	{
-		_growth += _grow_rate;
-		if (_growth >= 1.0)
+		_growth += _grow_rate * step;
+		if (_growth >= 1)
 		{
-			if (_left > 0)
-				_left -= 1;
-
-			if (_right < VIRTUAL_LED_COUNT)
-				_right += 1;
+			const int grow = _growth.toInt();
+			_left = max(_left - grow, 0);
+			_right = min(_right + grow, VIRTUAL_LED_COUNT);
 
-			_growth = 0.0;
+			_growth -= grow; // keep the fraction, it is part of the rate
+			changed = true;
 		}
 	}
 
 	if (_flow_vector != 0)
 	{
-		_flow += _flow_vector;
-		if (fabs(_flow) >= 1)
+		_flow += _flow_vector * step;
+		if (_flow.abs() >= 1)
 		{
+			const int flow = _flow.toInt();
 			if (_left > 1 && _left < VIRTUAL_LED_COUNT - _width)
 			{
-				_left += (int)_flow;
+				_left += flow;
 			}
 			if (_right > _width && _right < VIRTUAL_LED_COUNT)
-				_right += (int)_flow;
+				_right += flow;
 
-			_flow = 0.0;
+			_flow -= flow;
+			changed = true;
 		}
 	}
+	return changed;
 }
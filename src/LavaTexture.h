@@ -0,0 +1,62 @@
+#ifndef LAVA_TEXTURE_H
+#define LAVA_TEXTURE_H
+
+#include "Arduino.h"
+#include <FastLED.h>
+#include "config.h"
+
+#define LAVA_TEXTURE_SIZE 256 // colors per state, a power of two
+
+/*
+	Flicker of the lava, made once at startup instead of a random8() per LED
+	per frame.
+
+	The texture holds LAVA_TEXTURE_SIZE random colors for each state. A span
+	shows a window into it that starts at the LED index plus an offset, which
+	Scroll() moves to a random place once per frame, so the flicker still
+	changes every frame. Fill() then copies the window in at most a few
+	memcpy()s.
+*/
+class LavaTexture
+{
+public:
+	static const int OFF = 0; // same as Lava::OFF and Lava::ON
+	static const int ON = 1;
+
+	void Build()
+	{
+		for (int i = 0; i < LAVA_TEXTURE_SIZE; i++)
+		{
+			const int flicker = LAVA_OFF_BRIGHTNESS + random8(LAVA_OFF_BRIGHTNESS);
+			_colors[OFF][i] = CRGB(flicker, flicker * 2 / 3, 0);
+			_colors[ON][i] = random8(30) < 29 ? CRGB(150, 0, 0) : CRGB(180, 100, 0);
+		}
+	}
+
+	// once per frame
+	void Scroll()
+	{
+		_offset = random8();
+	}
+
+	// leds[first..last] in the colors of state
+	void Fill(CRGB *leds, int first, int last, int state)
+	{
+		const CRGB *colors = _colors[state];
+		int idx = (first + _offset) & (LAVA_TEXTURE_SIZE - 1);
+		int p = first;
+		while (p <= last)
+		{
+			const int n = min(last - p + 1, LAVA_TEXTURE_SIZE - idx);
+			memcpy(&leds[p], &colors[idx], n * sizeof(CRGB));
+			p += n;
+			idx = 0;
+		}
+	}
+
+private:
+	CRGB _colors[2][LAVA_TEXTURE_SIZE];
+	uint8_t _offset = 0;
+};
+
+#endif
@@ -0,0 +1,148 @@
+#ifndef MPU_INPUT_H
+#define MPU_INPUT_H
+
+#include "Arduino.h"
+#include <Wire.h>
+#include "config.h"
+#include "settings.h"
+#include "twang_mpu.h"
+#include "mpu_task.h"
+#include "TiltFilter.h"
+#include "samples.h"
+#include "InputSource.h"
+
+#define WOBBLE_SAMPLES 5 // the wobble is the highest gyro rate of this many samples
+
+/*
+	The gyro in the spring as an input source. mpu_task() samples it, Read()
+	takes every sample since the last frame: the tilt comes from a
+	TiltFilter, the wobble is the hardest shake in any of them.
+
+	With Reference, a second gyro in the base is read as well (if it is
+	there at startup) and its tilt and wobble are taken off, so the case
+	does not need to be flat on the ground. Without it, the code for it is
+	not built.
+
+	The axes follow JOYSTICK_ORIENTATION and are picked at compile time.
+	Latency is the age of the newest sample when the frame took it, errors
+	are samples the ring dropped and times the main gyro was lost.
+*/
+template <bool Reference>
+class MpuInput : public InputSource
+{
+public:
+	MpuInput() : InputSource(Reference ? "mpu_ref" : "mpu") {}
+
+	void Begin()
+	{
+		Wire.begin();
+		Wire.setClock(MPU_I2C_HZ);
+		_main.initialize();
+		_main.testConnection();
+		Serial.printf("Main gyro is %sconncted!\r\n", _main.connected ? "" : "NOT ");
+		if (Reference)
+		{
+			_ref.initialize();
+			_ref.testConnection();
+			Serial.printf("Reference gyro is %sconncted!\r\n", _ref.connected ? "" : "NOT ");
+		}
+		_connected = _main.connected;
+		mpu_start(&_main, &_ref);
+	}
+
+	bool Read(InputState *state)
+	{
+		if (_connected != mpuConnected)
+		{
+			_connected = mpuConnected;
+			Serial.println(_connected ? "Gyro connected!" : "Gyro disconnected!");
+			if (!_connected)
+				Lost(1);
+		}
+		const uint32_t dropped = mpuSamples.Dropped();
+		Lost(dropped - _dropped);
+		_dropped = dropped;
+
+		// drain what mpu_task() read since the last frame, the tilt filters take
+		// every sample, the wobble is the hardest shake in any of them
+		MpuSample s;
+		int samples = 0;
+		int wobble = 0;
+		bool hasRef = false;
+		while (mpuSamples.Pop(&s))
+		{
+			const uint32_t dtUs = s.us - _lastSampleUs;
+			_lastSampleUs = s.us;
+			_tilt.Update(mpu_accel<JOYSTICK_ORIENTATION>(s.main), mpu_accel<JOYSTICK_REST_AXIS>(s.main),
+						 JOYSTICK_TILT_GYRO_SIGN * mpu_gyro<JOYSTICK_TILT_GYRO_AXIS>(s.main), dtUs);
+			int g = mpu_gyro<JOYSTICK_ORIENTATION>(s.main);
+			if constexpr (Reference)
+			{
+				hasRef = s.hasRef;
+				if (hasRef)
+				{
+					_tiltRef.Update(mpu_accel<JOYSTICK_ORIENTATION>(s.ref), mpu_accel<JOYSTICK_REST_AXIS>(s.ref),
+									JOYSTICK_TILT_GYRO_SIGN * mpu_gyro<JOYSTICK_TILT_GYRO_AXIS>(s.ref), dtUs);
+					g -= mpu_gyro<JOYSTICK_ORIENTATION>(s.ref);
+				}
+			}
+			sample_add(&_wobbleSamples, g);
+			wobble = max(wobble, abs(sample_highest(&_wobbleSamples)));
+			samples++;
+		}
+		if (samples == 0)
+			return false; // nothing new, keep the last values
+		Took((uint32_t)esp_timer_get_time() - s.us);
+
+		// the same scale as the accel axis / 166 used to be, 98 at 90 degrees
+		int a = (int32_t)isin16(_tilt.Angle()) * (16384 / 166) / ISIN_MAX;
+		if (hasRef)
+			a -= (int32_t)isin16(_tiltRef.Angle()) * (16384 / 166) / ISIN_MAX;
+		if (abs(a) < user_settings.joystick_deadzone)
+			a = 0;
+		if (a > 0)
+			a -= user_settings.joystick_deadzone;
+		if (a < 0)
+			a += user_settings.joystick_deadzone;
+
+		state->tilt = JOYSTICK_DIRECTION == 1 ? -a : a;
+		state->wobble = wobble;
+
+#ifdef JOYSTICK_DEBUG
+		static unsigned long lastInputPrint = 0;
+#define PRINT_INTERVAL 500
+		if (millis() - lastInputPrint > PRINT_INTERVAL)
+		{
+			Serial.printf("Joystick  - a = (%6d, %6d, %6d), g = (%6d, %6d, %6d)\n",
+						  s.main.ax, s.main.ay, s.main.az, s.main.gx, s.main.gy, s.main.gz);
+			if (hasRef)
+				Serial.printf("Reference - a = (%6d, %6d, %6d), g = (%6d, %6d, %6d)\n",
+							  s.ref.ax, s.ref.ay, s.ref.az, s.ref.gx, s.ref.gy, s.ref.gz);
+
+			Serial.printf("Result: %d samples, tilt = %6d, wobble = %6d, dropped = %u, gyro bias = %d/256\n",
+						  samples, state->tilt, state->wobble, dropped, _tilt.Bias());
+			lastInputPrint = millis();
+		}
+#endif
+
+		return true;
+	}
+
+private:
+	// Main gyro in spring, tracks its connected state and mpu_task() will try to
+	// reconnect it every 2s, if connection drops
+	Twang_MPU _main = Twang_MPU(Twang_MPU::MPU_ADDR_DEFAULT);
+	// A "rference" gyro mounted in the base of the case, will be used for delta
+	// calculation for a better handheld experience (so the case does not need to be
+	// flat on the ground). Will only be connected once at startup and then ignored
+	// if later disconnected. Never connected without Reference.
+	Twang_MPU _ref = Twang_MPU(Twang_MPU::MPU_ADDR_ALTERNATIVE);
+	bool _connected = false; // mpuConnected as Read() last saw it
+	uint32_t _dropped = 0;	 // mpuSamples.Dropped() as Read() last saw it
+	TiltFilter _tilt;
+	TiltFilter _tiltRef;
+	uint32_t _lastSampleUs = 0;
+	Samples<int, WOBBLE_SAMPLES> _wobbleSamples;
+};
+
+#endif
@@ -0,0 +1,104 @@
+#ifndef PARTICLES_H
+#define PARTICLES_H
+
+#include "Arduino.h"
+
+#define USE_GRAVITY 0  // 0/1 use gravity (LED strip going up wall)
+#define BEND_POINT 550 // 0/1000 point at which the LED strip goes up the wall
+
+// positions are kept in 1/7 world units, so a tick adds the speed without a divide
+#define PARTICLE_POS_SCALE 7
+#define PARTICLE_MAX_LIFE 100 // brightness is PARTICLE_MAX_LIFE - life
+
+/*
+	A burst of particles. Each gets a random speed up to maxSpeed (either way)
+	and starts at life lifeBase - |speed|, so the fast ones are the bright
+	ones and the slow ones may not show at all.
+*/
+typedef struct ParticleEmitter
+{
+	uint16_t count;
+	int16_t maxSpeed;
+	int16_t lifeBase;
+} ParticleEmitter;
+
+/*
+	All particles of the game as a structure of arrays, N is the budget: no
+	more than N are ever alive, updated or drawn in a frame. Live particles
+	are packed at the front, a dead one is replaced by the last one.
+*/
+template <uint16_t N>
+class Particles
+{
+public:
+	// adds up to e.count particles at world position pos, as many as the budget allows
+	void Emit(const ParticleEmitter &e, int pos)
+	{
+		uint16_t n = min((uint16_t)(N - _count), e.count);
+		for (uint16_t i = 0; i < n; i++)
+		{
+			int16_t sp = random(-e.maxSpeed, e.maxSpeed);
+			_x[_count] = pos * PARTICLE_POS_SCALE;
+			_sp[_count] = sp;
+			_life[_count] = e.lifeBase - abs(sp);
+			_count++;
+		}
+		if (_count > _highWater)
+			_highWater = _count;
+	}
+
+	// moves every particle one frame, returns false when none are left
+	bool Tick()
+	{
+		const int16_t xMax = VIRTUAL_LED_COUNT * PARTICLE_POS_SCALE;
+		uint16_t i = 0;
+		while (i < _count)
+		{
+			int16_t life = ++_life[i];
+			if (life >= PARTICLE_MAX_LIFE)
+			{
+				_count--;
+				_x[i] = _x[_count];
+				_sp[i] = _sp[_count];
+				_life[i] = _life[_count];
+				continue;
+			}
+
+			// slow down, faster the older it gets
+			int16_t sp = _sp[i];
+			const int16_t drag = life / 10;
+			sp += sp > 0 ? -drag : drag;
+			if (USE_GRAVITY && _x[i] > BEND_POINT * PARTICLE_POS_SCALE)
+				sp -= 10;
+
+			int16_t x = _x[i] + sp;
+			if (x > xMax || x < 0)
+			{
+				x = x < 0 ? 0 : xMax;
+				sp = -(sp / 2); // bounce off the ends
+			}
+			_x[i] = x;
+			_sp[i] = sp;
+			i++;
+		}
+		return _count > 0;
+	}
+
+	void Clear() { _count = 0; }
+
+	uint16_t Count() const { return _count; }
+	uint16_t HighWater() const { return _highWater; }
+	// world position of particle i
+	int Pos(uint16_t i) const { return _x[i] / PARTICLE_POS_SCALE; }
+	// 1..PARTICLE_MAX_LIFE-1, fades towards 1
+	int Power(uint16_t i) const { return PARTICLE_MAX_LIFE - _life[i]; }
+
+private:
+	int16_t _x[N];
+	int16_t _sp[N];
+	int16_t _life[N];
+	uint16_t _count = 0;
+	uint16_t _highWater = 0;
+};
+
+#endif
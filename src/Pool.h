@@ -0,0 +1,128 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include "Arduino.h"
+
+/*
+	Fixed capacity pool of N objects of type T, no heap.
+
+	Spawn() hands out a free object in O(1) (or NULL if all N are in use), the
+	caller then initializes it, usually with T::Spawn(). The objects in use are
+	kept in a dense list, walk it with Count() and operator[]. Kill() returns an
+	object in O(1) by moving the last one in the list into its place, so when
+	killing while walking the list, walk it backwards:
+
+		for (int i = enemyPool.Count() - 1; i >= 0; i--)
+			if (...)
+				enemyPool.Kill(&enemyPool[i]);
+*/
+template <typename T, uint16_t N>
+class Pool
+{
+public:
+	static const uint16_t CAPACITY = N;
+
+	Pool()
+	{
+		_highWater = 0;
+		Clear();
+	}
+
+	T *Spawn()
+	{
+		if (_freeHead == N)
+			return NULL;
+		uint16_t slot = _freeHead;
+		_freeHead = _link[slot];
+		_link[slot] = _count;
+		_used[_count++] = slot;
+		if (_count > _highWater)
+			_highWater = _count;
+		return &_items[slot];
+	}
+
+	// ignores objects that are not in use, so killing twice is harmless
+	void Kill(T *item)
+	{
+		uint16_t slot = item - _items;
+		if (slot >= N)
+			return;
+		uint16_t idx = _link[slot];
+		if (idx >= _count || _used[idx] != slot)
+			return;
+		uint16_t last = _used[--_count];
+		_used[idx] = last;
+		_link[last] = idx;
+		_link[slot] = _freeHead;
+		_freeHead = slot;
+	}
+
+	void Clear()
+	{
+		_count = 0;
+		for (uint16_t slot = 0; slot < N; slot++)
+			_link[slot] = slot + 1;
+		_freeHead = 0;
+	}
+
+	// Insertion sort of the list, stable and O(Count()) when it is sorted
+	// already, so sorting every frame only pays for what moved since the last
+	// one. less(a, b) is true if a goes before b.
+	template <typename Less>
+	void Sort(Less less)
+	{
+		for (uint16_t i = 1; i < _count; i++)
+		{
+			uint16_t slot = _used[i];
+			int j = i - 1;
+			while (j >= 0 && less(_items[slot], _items[_used[j]]))
+			{
+				_used[j + 1] = _used[j];
+				_link[_used[j + 1]] = j + 1;
+				j--;
+			}
+			_used[j + 1] = slot;
+			_link[slot] = j + 1;
+		}
+	}
+
+	// Kill()s every object dead(item) is true for, in one pass that keeps the
+	// order of the others
+	template <typename Dead>
+	void Reap(Dead dead)
+	{
+		uint16_t kept = 0;
+		for (uint16_t i = 0; i < _count; i++)
+		{
+			uint16_t slot = _used[i];
+			if (dead(_items[slot]))
+			{
+				_link[slot] = _freeHead;
+				_freeHead = slot;
+			}
+			else
+			{
+				_used[kept] = slot;
+				_link[slot] = kept++;
+			}
+		}
+		_count = kept;
+	}
+
+	// i-th object in use, 0..Count()-1
+	T &operator[](uint16_t i) { return _items[_used[i]]; }
+
+	uint16_t Count() const { return _count; }
+	// the most objects that were ever in use at the same time
+	uint16_t HighWater() const { return _highWater; }
+
+private:
+	T _items[N];
+	uint16_t _used[N]; // slots in use, dense
+	uint16_t _link[N]; // in use: index in _used[], free: next free slot (N ends the list)
+	uint16_t _freeHead;
+	uint16_t _count;
+	uint16_t _highWater;
+};
+
+#endif
@@ -3,7 +3,7 @@
 class Spawner
 {
 public:
-    void Spawn(int pos, int rate_ms, int speed, int dir, int startOffset_ms);
+    void Spawn(int pos, int rate_ms, int speed, int dir, int startOffset_ms, unsigned long now);
     void Kill();
     int Alive();
     int _pos;
@@ -17,13 +17,13 @@ private:
     int _alive;
 };
 
-void Spawner::Spawn(int pos, int rate_ms, int speed, int dir, int startOffset_ms)
+void Spawner::Spawn(int pos, int rate_ms, int speed, int dir, int startOffset_ms, unsigned long now)
 {
     _pos = pos;
     _rate = rate_ms;
     _sp = speed;
     _dir = dir;
-    _lastSpawned = millis();
+    _lastSpawned = now;
     _delayOnce = startOffset_ms;
     _alive = 1;
 }
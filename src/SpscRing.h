@@ -0,0 +1,63 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include "Arduino.h"
+#include <atomic>
+
+/*
+	Fixed capacity queue of N objects of type T between exactly one producer
+	and one consumer, e.g. a sensor task and loop(), no heap and no locks.
+
+	Only the producer calls Push() and only the consumer Pop(), each side
+	writes just its own index, so neither ever waits for the other. When the
+	queue is full, Push() drops the new object and counts it, the consumer
+	gets the older ones it has not seen yet. N has to be a power of two.
+*/
+template <typename T, uint16_t N>
+class SpscRing
+{
+	static_assert(N > 0 && (N & (N - 1)) == 0, "N has to be a power of two");
+
+public:
+	// producer side, false if the queue was full and item was dropped
+	bool Push(const T &item)
+	{
+		const uint16_t head = _head.load(std::memory_order_relaxed);
+		if ((uint16_t)(head - _tail.load(std::memory_order_acquire)) == N)
+		{
+			_dropped.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		_items[head & (N - 1)] = item;
+		_head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	// consumer side, false if the queue is empty
+	bool Pop(T *item)
+	{
+		const uint16_t tail = _tail.load(std::memory_order_relaxed);
+		if (tail == _head.load(std::memory_order_acquire))
+			return false;
+		*item = _items[tail & (N - 1)];
+		_tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	// objects waiting to be popped, a snapshot
+	uint16_t Count() const
+	{
+		return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire);
+	}
+
+	// objects Push() dropped because the queue was full
+	uint32_t Dropped() const { return _dropped.load(std::memory_order_relaxed); }
+
+private:
+	T _items[N];
+	std::atomic<uint16_t> _head{0}; // next slot to write, only the producer writes it
+	std::atomic<uint16_t> _tail{0}; // next slot to read, only the consumer writes it
+	std::atomic<uint32_t> _dropped{0};
+};
+
+#endif
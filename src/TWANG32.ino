@@ -33,22 +33,33 @@
 
 #include <FastLED.h>
 #include <Wire.h>
+#include <atomic>
 #include "Arduino.h"
 
 // twang files
 #include "config.h"
-#include "twang_mpu.h"
-#include "enemy.h"
-#include "particle.h"
-#include "spawner.h"
-#include "lava.h"
-#include "boss.h"
-#include "conveyor.h"
+#include "fixed.h"
+#include "frame.h"
+#include "profiler.h"
+#include "InputSource.h"
+#ifdef USE_MPU
+#include "MpuInput.h"
+#endif
+#include "c64_joystick.h"
+#include "Enemy.h"
+#include "Particles.h"
+#include "Spawner.h"
+#include "Lava.h"
+#include "LavaTexture.h"
+#include "Boss.h"
+#include "Conveyor.h"
+#include "Pool.h"
+#include "IntervalIndex.h"
 #include "iSin.h"
 #include "sound.h"
 #include "settings.h"
+#include "render.h"
 #include "wifi_ap.h"
-#include "samples.h"
 
 #if defined(FASTLED_VERSION) && (FASTLED_VERSION < 3001000)
 #error "Requires FastLED 3.1 or later; check github for latest code."
@@ -58,12 +69,31 @@
 #define USE_GRAVITY 0  // 0/1 use gravity (LED strip going up wall)
 
 // GAME
-long previousMillis = 0; // Time of the last redraw
+// Time of the current frame, set once per frame by loop(). Tick, draw and SFX
+// functions get it passed in, helpers called from deep within them (like
+// loadLevel() or die()) read it from here.
+FrameTime frameTime;
 
 #define TIMEOUT 20000 // time until screen saver in milliseconds
 
-int joystickTilt = 0;   // Stores the angle of the joystick
-int joystickWobble = 0; // Stores the max amount of acceleration (wobble)
+// the input sources picked in config.h, see InputSource.h
+#ifdef USE_SCRIPTED_INPUT
+typedef ScriptedInput ScriptedSource;
+#else
+typedef NoInput ScriptedSource;
+#endif
+#ifdef USE_C64_JOYSTICK
+typedef C64Input C64Source;
+#else
+typedef NoInput C64Source;
+#endif
+#ifdef USE_MPU
+typedef MpuInput<MPU_REFERENCE> MpuSource;
+#else
+typedef NoInput MpuSource;
+#endif
+InputMux<ScriptedSource, C64Source, MpuSource> gameInput;
+InputState joystick = {0, 0}; // the angle of the joystick and the max amount of acceleration (wobble)
 
 // WOBBLE ATTACK
 #define DEFAULT_ATTACK_WIDTH 70 // Width of the wobble attack, world is 1000 wide
@@ -87,46 +117,36 @@ int attackStartLED = 0, attackEndLED = 0; // leds affected by attack
 #define WIN_CLEAR_DURATION 1000
 #define WIN_OFF_DURATION 1200
 
-// Main gyro in spring, tracks its connected state and this code will try to
-// reconnect it every 2s, if connection drops
-Twang_MPU accelgyro = Twang_MPU(Twang_MPU::MPU_ADDR_DEFAULT);
-// A "rference" gyro mounted in the base of the case, will be used for delta
-// calculation for a better handheld experience (so the case does not need to be
-// flat on the ground). Will only be connected once at startup and then ignored
-// if later disconnected.
-Twang_MPU accelgyro_ref = Twang_MPU(Twang_MPU::MPU_ADDR_ALTERNATIVE);
-unsigned long gyroLastCheckMs = 0;
-const unsigned long GYRO_CHECK_INTERVAL_MS = 2000;
-Samples MPUAngleSamples = {0};
-Samples MPUWobbleSamples = {0};
-
-CRGB leds[VIRTUAL_LED_COUNT];
-iSin isin = iSin();
-
-// #define JOYSTICK_DEBUG  // comment out to stop serial debugging
-
 // POOLS
+#ifdef ENEMY_SWARM
+#define ENEMY_COUNT 256
+#else
 #define ENEMY_COUNT 10
-Enemy enemyPool[ENEMY_COUNT] = {
-    Enemy(), Enemy(), Enemy(), Enemy(), Enemy(), Enemy(), Enemy(), Enemy(), Enemy(), Enemy()};
+#endif
+Pool<Enemy, ENEMY_COUNT> enemyPool; // sorted by position, see tickEnemies()
 
-#define PARTICLE_COUNT 100
-Particle particlePool[PARTICLE_COUNT] = {
-    Particle(), Particle(), Particle(), Particle(), Particle(), Particle(), Particle(), Particle(), Particle(), Particle(), Particle(), Particle(), Particle(), Particle(), Particle(), Particle(), Particle(), Particle(), Particle(), Particle(), Particle(), Particle(), Particle(), Particle(), Particle(), Particle(), Particle(), Particle(), Particle(), Particle(), Particle(), Particle(), Particle(), Particle(), Particle(), Particle(), Particle(), Particle(), Particle(), Particle()};
+#define PARTICLE_COUNT 100 // most particles alive in one frame
+Particles<PARTICLE_COUNT> particles;
+const ParticleEmitter DEATH_BURST = {PARTICLE_COUNT, 200, 220};
+const ParticleEmitter ENEMY_KILL_BURST = {12, 150, 190};
+const ParticleEmitter BOSS_HIT_BURST = {40, 200, 230};
 
 #define SPAWN_COUNT 5
-Spawner spawnPool[SPAWN_COUNT] = {
-    Spawner(), Spawner()};
+Pool<Spawner, SPAWN_COUNT> spawnPool;
 
-#define LAVA_COUNT 5
-Lava lavaPool[LAVA_COUNT] = {
-    Lava(), Lava(), Lava(), Lava()};
+#define LAVA_COUNT 16
+Pool<Lava, LAVA_COUNT> lavaPool;
+IntervalIndex<LAVA_COUNT> lavaIndex; // lava that is ON, see updateLavaIndex()
+bool lavaIndexDirty = true;
+LavaTexture lavaTexture;
 
-#define CONVEYOR_COUNT 4
-Conveyor conveyorPool[CONVEYOR_COUNT] = {
-    Conveyor(), Conveyor()};
+#define CONVEYOR_COUNT 8
+Pool<Conveyor, CONVEYOR_COUNT> conveyorPool;
+IntervalIndex<CONVEYOR_COUNT> conveyorIndex; // values are indexes into conveyorPool, see conveyorAt()
+bool conveyorIndexDirty = true;
 
 Boss boss = Boss();
+Spawner *bossSpawners[2] = {NULL, NULL}; // in spawnPool while the boss lives
 
 enum stages
 {
@@ -142,6 +162,7 @@ enum stages
 long stageStartTime;        // Stores the time the stage changed for stages that are time based
 int playerPosition;         // Stores the player position
 int playerPositionModifier; // +/- adjustment to player position
+uint8_t playerCarry = 0;    // see frame_move()
 bool playerAlive;
 long killTime;
 int lives = LIVES_PER_LEVEL;
@@ -152,6 +173,16 @@ int lives = LIVES_PER_LEVEL;
 static TaskHandle_t FastLEDshowTaskHandle = 0;
 static TaskHandle_t userTaskHandle = 0;
 
+// -- Set while the show task sends ledsFront[], cleared by the show task when done
+static std::atomic<bool> showInFlight(false);
+// -- Brightness the front buffer was drawn with, the game may change it for the next frame
+static uint8_t showBrightness = 0;
+// -- How many LEDs of the front buffer to send, usually user_settings.led_end
+static int showLedCount = MAX_LEDS;
+// -- How long the last show took, for frame_pace()
+static std::atomic<uint32_t> showCycles(0);
+static CLEDController *ledController = NULL;
+
 long mapconstrain(long x, long in_min, long in_max, long out_min, long out_max) {
     assert(in_min < in_max);
 
@@ -167,25 +198,46 @@ long mapconstrain(long x, long in_min, long in_max, long out_min, long out_max)
 }
 
 /** show() for ESP32
- *  Call this function instead of FastLED.show(). It signals core 0 to issue a show,
- *  then waits for a notification that it is done.
+ *  Call this function instead of FastLED.show(). It swaps the back buffer to the
+ *  front and signals core 0 to issue a show, without waiting for it. Only if
+ *  the previous show is still in flight, it waits for that one to finish first.
+ *  A frame that looks like the last one is skipped, see SKIP_UNCHANGED_FRAMES.
  */
 void FastLEDshowESP32()
 {
-    if (userTaskHandle == 0)
-    {
-        // -- Store the handle of the current task, so that the show task can
-        //    notify it when it's done
-        userTaskHandle = xTaskGetCurrentTaskHandle();
+    static unsigned long lastShowMs = 0;
+    unsigned long now = millis();
+    // the strip got shorter or moved, send at the old length once more (now
+    // blank), so the LEDs that are no longer sent go dark
+    const bool resized = render_checkWindow();
+#ifdef SKIP_UNCHANGED_FRAMES
+    if (!render_pending(ledsFront) && FastLED.getBrightness() == showBrightness && now - lastShowMs < SHOW_KEEPALIVE_MS)
+    {
+        showSkippedCount++;
+        return;
+    }
+#endif
+    lastShowMs = now;
+    showSentCount++;
 
-        // -- Trigger the show task
-        xTaskNotifyGive(FastLEDshowTaskHandle);
+    if (showInFlight)
+    {
+        showInFlightCount++;
 
-        // -- Wait to be notified that it's done
+        // -- Wait to be notified that it's done, there might be stale
+        //    notifications from shows that finished while nobody waited
         const TickType_t xMaxBlockTime = pdMS_TO_TICKS(200);
-        ulTaskNotifyTake(pdTRUE, xMaxBlockTime);
-        userTaskHandle = 0;
+        while (showInFlight && ulTaskNotifyTake(pdTRUE, xMaxBlockTime) > 0)
+            ;
     }
+
+    render_push(ledsFront);
+    showBrightness = FastLED.getBrightness();
+    showLedCount = resized ? max(showLedCount, (int)user_settings.led_end) : user_settings.led_end;
+    showInFlight = true;
+
+    // -- Trigger the show task
+    xTaskNotifyGive(FastLEDshowTaskHandle);
 }
 
 /** show Task
@@ -199,8 +251,12 @@ void FastLEDshowTask(void *pvParameters)
         // -- Wait for the trigger
         ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
 
-        // -- Do the show (synchronously)
-        FastLED.show();
+        // -- Do the show (synchronously), only as far as the strip goes
+        uint32_t startCycles = ESP.getCycleCount();
+        ledController->setLeds(ledsFront, showLedCount);
+        FastLED.show(showBrightness);
+        showCycles = ESP.getCycleCount() - startCycles;
+        showInFlight = false;
 
         // -- Notify the calling task
         xTaskNotifyGive(userTaskHandle);
@@ -215,29 +271,16 @@ void setup()
 
     settings_init(); // load the user settings from EEPROM
 
-    Wire.begin();
-    accelgyro.initialize();
-    accelgyro.testConnection();
-    accelgyro_ref.initialize();
-    accelgyro_ref.testConnection();
-    gyroLastCheckMs = millis();
-    Serial.printf("Main gyro is %sconncted!\r\n", accelgyro.connected ? "" : "NOT ");
-    Serial.printf("Reference gyro is %sconncted!\r\n", accelgyro_ref.connected ? "" : "NOT ");
+    gameInput.Begin();
 
 #ifdef USE_NEOPIXEL
     Serial.print("\r\nCompiled for WS2812B (Neopixel) LEDs");
-    FastLED.addLeds<LED_TYPE, DATA_PIN>(leds, MAX_LEDS);
+    ledController = &FastLED.addLeds<LED_TYPE, DATA_PIN>(ledsFront, MAX_LEDS);
 #endif
 
 #ifdef USE_APA102
     Serial.print("\r\nCompiled for APA102 (Dotstar) LEDs");
-    FastLED.addLeds<LED_TYPE, DATA_PIN, CLOCK_PIN, LED_COLOR_ORDER>(leds, MAX_LEDS);
-#endif
-#ifdef USE_C64_JOYSTICK
-    Serial.print("\r\nCompiled for C64 Joystick");
-    pinMode(C64_JOY_PIN_UP, INPUT_PULLDOWN);
-    pinMode(C64_JOY_PIN_DOWN, INPUT_PULLDOWN);
-    pinMode(C64_JOY_PIN_FIRE, INPUT_PULLDOWN);
+    ledController = &FastLED.addLeds<LED_TYPE, DATA_PIN, CLOCK_PIN, LED_COLOR_ORDER>(ledsFront, MAX_LEDS);
 #endif
 
 
@@ -245,70 +288,51 @@ void setup()
     FastLED.setBrightness(user_settings.led_brightness);
     FastLED.setDither(1);
 
-    // -- Create the ESP32 FastLED show task
+    // -- Create the ESP32 FastLED show task, it notifies this (the loop) task
+    //    when a show is done
+    userTaskHandle = xTaskGetCurrentTaskHandle();
     xTaskCreatePinnedToCore(FastLEDshowTask, "FastLEDshowTask", 2048, NULL, 2, &FastLEDshowTaskHandle, FASTLED_SHOW_CORE);
 
     sound_init();
 
     ap_setup();
 
+    lavaTexture.Build();
+    buildConveyorPatterns();
+    prof_init();
+    frame_init(&frameTime);
     stage = STARTUP;
-    stageStartTime = millis();
+    stageStartTime = frameTime.ms;
     lives = user_settings.lives_per_level;
 }
 
 void loop()
 {
-    long mm = millis();
-
-    settings_param_t param = ap_client_check(); // check for web client
-	if (Serial.available())
-	{
-        // will overwrite if ap page is submitted at the same time, but
-        // that will almost never happen and if it does, that's life...
-		param = settings_processSerial(Serial.read());
-	}
-    settings_set(param);
-    if (param.code == 'V' && param.hasValue)
-        loadLevel(levelNumber);
-
-    if (stage == PLAY)
-    {
-        if (attacking)
-        {
-            SFXattacking();
-        }
-        else
-        {
-            SFXtilt(joystickTilt);
-        }
-    }
-    else if (stage == DEAD)
+    // everything below runs once per frame, in between the task sleeps
+    frame_wait(&frameTime);
+    if (frame_next(&frameTime))
     {
-        SFXdead();
-    }
+        const FrameTime &ft = frameTime;
+        long mm = ft.ms;
+        uint32_t frameStartCycles = ESP.getCycleCount();
 
-    if (mm - previousMillis >= MIN_REDRAW_INTERVAL)
-    {
-        if (accelgyro.connected)
+        settings_param_t param;
+        PROFILE(PROF_AP_CLIENT, param = ap_client_check()); // check for web client
+        if (Serial.available())
         {
-            getInput();
-            if (!accelgyro.connected)
-                Serial.println("Gyro disconnected!");
+            // will overwrite if ap page is submitted at the same time, but
+            // that will almost never happen and if it does, that's life...
+            param = settings_processSerial(Serial.read());
         }
-        else if (millis() - gyroLastCheckMs > GYRO_CHECK_INTERVAL_MS)
-        {
-            accelgyro.initialize();
-            accelgyro.testConnection();
-            gyroLastCheckMs = millis();
-            if (accelgyro.connected)
-                Serial.println("Gyro connected!");
-        }
-        getC64JoystickInput();
-        long frameTimer = mm;
-        previousMillis = mm;
+        settings_set(param);
+        if (param.code == 'V' && param.hasValue)
+            loadLevel(levelNumber);
+
+        uint32_t inputStartCycles = ESP.getCycleCount();
+        gameInput.Read(&joystick);
+        prof_record(PROF_INPUT, ESP.getCycleCount() - inputStartCycles);
 
-        if (abs(joystickTilt) > user_settings.joystick_deadzone)
+        if (abs(joystick.tilt) > user_settings.joystick_deadzone)
         {
             lastInputTime = mm;
             if (stage == SCREENSAVER)
@@ -332,13 +356,13 @@ void loop()
 
         if (stage == SCREENSAVER)
         {
-            screenSaverTick();
+            PROFILE(PROF_ANIMATION, screenSaverTick(ft));
         }
         else if (stage == STARTUP)
         {
             if (stageStartTime + STARTUP_FADE_DUR > mm)
             {
-                tickStartup(mm);
+                PROFILE(PROF_ANIMATION, tickStartup(ft));
             }
             else
             {
@@ -354,7 +378,7 @@ void loop()
                 attacking = 0;
 
             // If not attacking, check if they should be
-            if (!attacking && joystickWobble >= user_settings.attack_threshold)
+            if (!attacking && joystick.wobble >= user_settings.attack_threshold)
             {
                 attackMillis = mm;
                 attacking = 1;
@@ -362,22 +386,25 @@ void loop()
 
             if (attacking)
             {
+                SFXattacking(ft);
                 attackStartLED = getLED(playerPosition - (attack_width / 2));
                 attackEndLED = getLED(playerPosition + (attack_width / 2));
             }
 
-            // If still not attacking, move!
-            playerPosition += playerPositionModifier;
+            // If still not attacking, move! Conveyors move the player either way.
+            int speed = playerPositionModifier;
             if (!attacking)
             {
-                SFXtilt(joystickTilt);
-                // int moveAmount = (joystickTilt/6.0);  // 6.0 is ideal at 16ms interval (6.0 / (16.0 / MIN_REDRAW_INTERVAL))
-                int moveAmount = (joystickTilt / (6.0)); // 6.0 is ideal at 16ms interval
+                SFXtilt(joystick.tilt);
+                int moveAmount = joystick.tilt / 6; // world units per frame at SPEED_BASE_FPS
                 if (DIRECTION)
                     moveAmount = -moveAmount;
                 moveAmount = constrain(moveAmount, -MAX_PLAYER_SPEED, MAX_PLAYER_SPEED);
-
-                playerPosition -= moveAmount;
+                speed -= moveAmount;
+            }
+            playerPosition += frame_move(ft, speed, &playerCarry);
+            if (!attacking)
+            {
                 if (playerPosition < 0)
                     playerPosition = 0;
 
@@ -393,28 +420,33 @@ void loop()
                 }
             }
 
-            if (inLava(playerPosition))
-            {
-                die();
-            }
-
-            // Ticks and draw calls
-            FastLED.clear();
-            tickConveyors();
-            tickSpawners();
-            tickBoss();
-            tickLava();
-            tickEnemies();
+            // Ticks and draw calls, the clear and the draws are one PROF_DRAW
+            uint32_t drawCycles = ESP.getCycleCount();
+            render_clear();
+            drawCycles = ESP.getCycleCount() - drawCycles;
+            PROFILE(PROF_CONVEYORS, tickConveyors(ft));
+            PROFILE(PROF_SPAWNERS, tickSpawners(ft));
+            PROFILE(PROF_BOSS, tickBoss());
+            PROFILE(PROF_LAVA, tickLava(ft));
+            PROFILE(PROF_ENEMIES, tickEnemies(ft));
+            PROFILE(PROF_COLLISIONS, resolveCollisions());
+            PROFILE(PROF_PARTICLES, tickParticles(ft)); // bursts of killed enemies
+            uint32_t drawStart = ESP.getCycleCount();
+            drawEnemies();
             drawPlayer();
-            drawAttack();
+            drawAttack(ft);
             drawExit();
+            prof_record(PROF_DRAW, drawCycles + ESP.getCycleCount() - drawStart);
         }
         else if (stage == DEAD)
         {
             // DEAD
-            FastLED.clear();
-            tickDie(mm);
-            if (!tickParticles())
+            bool particlesAlive;
+            SFXdead(ft);
+            PROFILE(PROF_DRAW, render_clear());
+            PROFILE(PROF_ANIMATION, tickDie(ft));
+            PROFILE(PROF_PARTICLES, particlesAlive = tickParticles(ft));
+            if (!particlesAlive)
             {
                 loadLevel(levelNumber);
             }
@@ -422,33 +454,40 @@ void loop()
         else if (stage == WIN)
         {
             // LEVEL COMPLETE
-            tickWin(mm);
+            PROFILE(PROF_ANIMATION, tickWin(ft));
         }
         else if (stage == BOSS_KILLED)
         {
-            tickBossKilled(mm);
+            PROFILE(PROF_ANIMATION, tickBossKilled(ft));
         }
         else if (stage == GAMEOVER)
         {
             if (stageStartTime + GAMEOVER_FADE_DURATION > mm)
             {
-                tickGameover(mm);
+                PROFILE(PROF_ANIMATION, tickGameover(ft));
             }
             else
             {
-                FastLED.clear();
+                render_clear();
                 save_game_stats(false); // boss not killed
                 score = 0;
 
                 // restart from the beginning
                 stage = STARTUP;
-                stageStartTime = millis();
+                stageStartTime = mm;
                 lives = user_settings.lives_per_level;
             }
         }
 
         // FastLED.show();
-        FastLEDshowESP32();
+        PROFILE(PROF_SHOW, FastLEDshowESP32());
+
+        prof_record(PROF_FRAME, ESP.getCycleCount() - frameStartCycles);
+        prof_endFrame();
+
+        // Only the show time sets the pace, a frame that takes long once (like
+        // drawLives() with its delays) is caught up with by frame_next().
+        frame_pace(prof_cyclesToUs(showCycles));
     }
 }
 
@@ -483,6 +522,7 @@ void loadLevel(int num)
 {
     // leave these alone
     updateLives();
+    frame_restart(&frameTime); // drawLives() blocks for a while, don't count that as level time
     cleanupLevel();
     playerAlive = 1;
     FastLED.setBrightness(user_settings.led_brightness);
@@ -509,12 +549,12 @@ void loadLevel(int num)
     spawnSpawner(): This generates and endless source of new enemies. 
       5 (SPAWN_COUNT) pools max
 
-    spawnLava(): You can create 5 (LAVA_COUNT) pools of lava. 
+    spawnLava(): You can create 16 (LAVA_COUNT) pools of lava. 
       Lava will toggle on and off in an interval. 
       Lava kills the player and enemies when on.
 
-    spawnConveyor(): You can create 4 (CONVEYOR_COUNT) conveyors. 
-      Conveyors move the player at a constant speed.
+    spawnConveyor(): You can create 8 (CONVEYOR_COUNT) conveyors. 
+      Conveyors move the player at a constant speed. They must not overlap.
 
     ===== Other things you can adjust per level ================
 
@@ -548,13 +588,13 @@ void loadLevel(int num)
         spawnSpawner(950, 4500, 3, 0, -3500);
         break;
     case LAVA_MOVING:
-        spawnLava(700, 800, 2000, 2000, 0, Lava::OFF, 0, -0.5);
+        spawnLava(700, 800, 2000, 2000, 0, Lava::OFF, 0, Fixed::fromFloat(-0.5));
         spawnEnemy(450, 0, 1, 0);
         spawnSpawner(950, 4500, 3, 0, -2000);
         break;
     case LAVA_SPREADING:
-        spawnLava(350, 400, 2000, 2000, 0, Lava::OFF, 0.2, 0);
-        spawnLava(750, 800, 2000, 2000, 0, Lava::OFF, 0.2, 0);
+        spawnLava(350, 400, 2000, 2000, 0, Lava::OFF, Fixed::fromFloat(0.2), 0);
+        spawnLava(750, 800, 2000, 2000, 0, Lava::OFF, Fixed::fromFloat(0.2), 0);
         spawnEnemy(400, 0, 2, 0);
         spawnEnemy(900, 0, 2, 0);
         break;
@@ -596,8 +636,8 @@ void loadLevel(int num)
         spawnEnemy(900, 0, 0, 0);
         break;
     case LAVA_SPREAD_FALL:
-        spawnLava(400, 450, 2000, 2000, 0, Lava::OFF, 0.25, -0.5);
-        spawnLava(850, 900, 2000, 2000, 0, Lava::OFF, 0.25, -0.5);
+        spawnLava(400, 450, 2000, 2000, 0, Lava::OFF, Fixed::fromFloat(0.25), Fixed::fromFloat(-0.5));
+        spawnLava(850, 900, 2000, 2000, 0, Lava::OFF, Fixed::fromFloat(0.25), Fixed::fromFloat(-0.5));
         spawnEnemy(350, 0, 1, 0);
         spawnSpawner(950, 4500, 3, 0, 0);
         break;
@@ -652,7 +692,7 @@ void loadLevel(int num)
         spawnBoss();
         break;
     }
-    lastInputTime = stageStartTime = millis();
+    lastInputTime = stageStartTime = frameTime.ms;
     stage = PLAY;
 }
 
@@ -669,14 +709,29 @@ void moveBoss()
         spawnSpeed = 1500;
     if (boss._lives == 1)
         spawnSpeed = 1000;
-    spawnPool[0].Spawn(boss._pos, spawnSpeed, 3, 0, 0);
-    spawnPool[1].Spawn(boss._pos, spawnSpeed, 3, 1, 0);
+    for (int dir = 0; dir < 2; dir++)
+    {
+        if (bossSpawners[dir] == NULL)
+            bossSpawners[dir] = spawnPool.Spawn();
+        if (bossSpawners[dir] != NULL)
+            bossSpawners[dir]->Spawn(boss._pos, spawnSpeed, 3, dir, 0, frameTime.ms);
+    }
+}
+
+void killBossSpawners()
+{
+    for (int dir = 0; dir < 2; dir++)
+    {
+        if (bossSpawners[dir] != NULL)
+            spawnPool.Kill(bossSpawners[dir]);
+        bossSpawners[dir] = NULL;
+    }
 }
 
 /* ======================== spawn Functions =====================================
 
-   The following spawn functions add items to pools by looking for an unactive
-   item in the pool. You can only add as many as the ..._COUNT. Additonal attemps
+   The following spawn functions add items to pools by taking a free item
+   from the pool. You can only add as many as the ..._COUNT. Additonal attemps
    to add will be ignored.
 
    ==============================================================================
@@ -687,14 +742,11 @@ void moveBoss()
 // @param wobble: 0=regular movement, >0 set length of bouncing back and forth in a sine pattern
 void spawnEnemy(int pos, int dir, int speed, int wobble)
 {
-    for (int e = 0; e < ENEMY_COUNT; e++)
-    { // look for one that is not alive for a place to add one
-        if (!enemyPool[e].Alive())
-        {
-            enemyPool[e].Spawn(pos, dir, speed, wobble);
-            enemyPool[e].playerSide = pos > playerPosition ? 1 : -1;
-            return;
-        }
+    Enemy *enemy = enemyPool.Spawn();
+    if (enemy)
+    {
+        enemy->Spawn(pos, dir, speed, wobble);
+        enemy->playerSide = pos > playerPosition ? 1 : -1;
     }
 }
 
@@ -705,14 +757,9 @@ void spawnEnemy(int pos, int dir, int speed, int wobble)
 // @param startOffset_ms: The delay in milliseconds before the first enemy (added to rate, can be negative)
 void spawnSpawner(int pos, int rate_ms, int speed, int dir, int startOffset_ms)
 {
-    for (int s = 0; s < SPAWN_COUNT; s++)
-    {
-        if (!spawnPool[s].Alive())
-        {
-            spawnPool[s].Spawn(pos, rate_ms, speed, dir, startOffset_ms);
-            return;
-        }
-    }
+    Spawner *spawner = spawnPool.Spawn();
+    if (spawner)
+        spawner->Spawn(pos, rate_ms, speed, dir, startOffset_ms, frameTime.ms);
 }
 
 // @param left: the lower end of the lava pool (in game coordinates, usually 0..1000)
@@ -723,16 +770,12 @@ void spawnSpawner(int pos, int rate_ms, int speed, int dir, int startOffset_ms)
 // @param state: does it start on or off (Lava::ON or Lava::OFF)
 // @param grow: This specifies the rate of growth. Use 0 for no growth. Reasonable growth is 0.1 to 0.5
 // @param flow: This specifies the rate/direction of flow. Reasonable numbers are 0.2 to 0.8 (positive or negative)
-void spawnLava(int left, int right, int ontime, int offtime, int offset, int state, float grow, float flow)
+void spawnLava(int left, int right, int ontime, int offtime, int offset, int state, Fixed grow, Fixed flow)
 {
-    for (int i = 0; i < LAVA_COUNT; i++)
-    {
-        if (!lavaPool[i].Alive())
-        {
-            lavaPool[i].Spawn(left, right, ontime, offtime, offset, state, grow, flow);
-            return;
-        }
-    }
+    Lava *lava = lavaPool.Spawn();
+    if (lava)
+        lava->Spawn(left, right, ontime, offtime, offset, state, grow, flow, frameTime.ms);
+    lavaIndexDirty = true;
 }
 
 // @param startPoint: The close end of the conveyor (in game coordinates 0..1000)
@@ -740,44 +783,27 @@ void spawnLava(int left, int right, int ontime, int offtime, int offset, int sta
 // @param dir: positive = away, negative = towards you (must be less than +/- MAX_PLAYER_SPEED=10)
 void spawnConveyor(int startPoint, int endPoint, int dir)
 {
-    for (int i = 0; i < CONVEYOR_COUNT; i++)
-    {
-        if (!conveyorPool[i]._alive)
-        {
-            conveyorPool[i].Spawn(startPoint, endPoint, dir);
-            return;
-        }
-    }
+    Conveyor *conveyor = conveyorPool.Spawn();
+    if (conveyor)
+        conveyor->Spawn(startPoint, endPoint, dir);
+    conveyorIndexDirty = true;
 }
 
 void cleanupLevel()
 {
-    for (int i = 0; i < ENEMY_COUNT; i++)
-    {
-        enemyPool[i].Kill();
-    }
-    for (int i = 0; i < PARTICLE_COUNT; i++)
-    {
-        particlePool[i].Kill();
-    }
-    for (int i = 0; i < SPAWN_COUNT; i++)
-    {
-        spawnPool[i].Kill();
-    }
-    for (int i = 0; i < LAVA_COUNT; i++)
-    {
-        lavaPool[i].Kill();
-    }
-    for (int i = 0; i < CONVEYOR_COUNT; i++)
-    {
-        conveyorPool[i].Kill();
-    }
+    enemyPool.Clear();
+    particles.Clear();
+    spawnPool.Clear();
+    lavaPool.Clear();
+    conveyorPool.Clear();
+    lavaIndexDirty = conveyorIndexDirty = true;
+    bossSpawners[0] = bossSpawners[1] = NULL;
     boss.Kill();
 }
 
 void levelComplete()
 {
-    stageStartTime = millis();
+    stageStartTime = frameTime.ms;
     stage = WIN;
 
     if (levelNumber == BOSS)
@@ -812,35 +838,31 @@ void die()
     if (lives == 0)
     {
         stage = GAMEOVER;
-        stageStartTime = millis();
+        stageStartTime = frameTime.ms;
     }
     else
     {
-        for (int p = 0; p < PARTICLE_COUNT; p++)
-        {
-            particlePool[p].Spawn(playerPosition);
-        }
-        stageStartTime = millis();
+        particles.Clear(); // the whole budget goes to the explosion
+        particles.Emit(DEATH_BURST, playerPosition);
+        stageStartTime = frameTime.ms;
         stage = DEAD;
     }
-    killTime = millis();
+    killTime = frameTime.ms;
 }
 
 // ----------------------------------
 // -------- TICKS & RENDERS ---------
 // ----------------------------------
-void tickStartup(long mm)
+void tickStartup(const FrameTime &ft)
 {
-    FastLED.clear();
+    long mm = ft.ms;
+    render_clear();
     // temporarily reduce brightness, since full strip will light up, which is much brighter in total
     FastLED.setBrightness(user_settings.led_brightness / 4);
     if (stageStartTime + STARTUP_WIPEUP_DUR > mm) // fill to the top with green
     {
         int n = mapconstrain(mm - stageStartTime, 0, STARTUP_WIPEUP_DUR, user_settings.led_offset, user_settings.led_end); // fill from top to bottom
-        for (int i = user_settings.led_offset; i < n; i++)
-        {
-            leds[i] = CRGB(0, 255, 0);
-        }
+        render_fill(user_settings.led_offset, n - 1, CRGB(0, 255, 0));
     }
     else if (stageStartTime + STARTUP_SPARKLE_DUR > mm) // sparkle the full green bar
     {
@@ -854,59 +876,41 @@ void tickStartup(long mm)
                 leds[i] = CRGB(flicker, 150, flicker); // some flicker brighter
             }
         }
+        render_dirtyWindow();
     }
     else if (stageStartTime + STARTUP_FADE_DUR > mm) // fade it out to bottom
     {
         int n = mapconstrain(mm - stageStartTime, STARTUP_SPARKLE_DUR, STARTUP_FADE_DUR, user_settings.led_offset, user_settings.led_end); // fill from top to bottom
         int brightness = mapconstrain(mm - stageStartTime, STARTUP_SPARKLE_DUR, STARTUP_FADE_DUR, 255, 0);
 
-        for (int i = n; i < user_settings.led_end; i++)
-        {
-            leds[i] = CRGB(0, brightness, 0);
-        }
+        render_fill(n, user_settings.led_end - 1, CRGB(0, brightness, 0));
     }
-    SFXFreqSweepWarble(STARTUP_FADE_DUR, millis() - stageStartTime, 40, 400, 20);
+    SFXFreqSweepWarble(ft, STARTUP_FADE_DUR, mm - stageStartTime, 40, 400, 20);
 }
 
-void tickEnemies()
+void tickEnemies(const FrameTime &ft)
 {
-    int attStart = map(attackStartLED, user_settings.led_offset, user_settings.led_end - 1, 0, VIRTUAL_LED_COUNT);
-    // making sure to cover the full range of the LED in virtual game space
-    int attEnd = map(attackEndLED + 1, user_settings.led_offset, user_settings.led_end - 1, 0, VIRTUAL_LED_COUNT) - 1;
+    // the ones that leave the world go back to the pool in resolveCollisions(),
+    // they can still hit the player on their way out
+    for (int i = 0; i < enemyPool.Count(); i++)
+    {
+        enemyPool[i].Tick(ft);
+    }
+    // Enemies only move a few units per frame and rarely pass each other, so
+    // this is close to a single pass. Collisions and drawing rely on the order.
+    enemyPool.Sort([](const Enemy &a, const Enemy &b) { return a._pos < b._pos; });
+}
 
-    for (int i = 0; i < ENEMY_COUNT; i++)
+void drawEnemies()
+{
+    // in position order, enemies that share an LED only write it once
+    int lastLED = -1;
+    for (int i = 0; i < enemyPool.Count(); i++)
     {
-        if (enemyPool[i].Alive())
-        {
-            enemyPool[i].Tick();
-            // Hit attack?
-            if (attacking)
-            {
-                if (enemyPool[i]._pos >= attStart && enemyPool[i]._pos <= attEnd)
-                {
-                    enemyPool[i].Kill();
-                    SFXkill();
-                }
-            }
-            if (inLava(enemyPool[i]._pos))
-            {
-                enemyPool[i].Kill();
-                SFXkill();
-            }
-            // Draw (if still alive)
-            if (enemyPool[i].Alive())
-            {
-                leds[getLED(enemyPool[i]._pos)] = CRGB(255, 0, 0);
-            }
-            // Hit player?
-            if (
-                (enemyPool[i].playerSide == 1 && enemyPool[i]._pos <= playerPosition) ||
-                (enemyPool[i].playerSide == -1 && enemyPool[i]._pos >= playerPosition))
-            {
-                die();
-                return;
-            }
-        }
+        const int led = getLED(enemyPool[i]._pos);
+        if (led != lastLED)
+            render_set(led, CRGB(255, 0, 0));
+        lastLED = led;
     }
 }
 
@@ -916,160 +920,243 @@ void tickBoss()
     if (boss.Alive())
     {
         boss._ticks++;
-        for (int i = getLED(boss._pos - BOSS_WIDTH / 2); i <= getLED(boss._pos + BOSS_WIDTH / 2); i++)
-        {
-            leds[i] = CRGB::DarkRed;
-            leds[i] %= 100;
-        }
-        // CHECK COLLISION
-        if (getLED(playerPosition) > getLED(boss._pos - BOSS_WIDTH / 2) && getLED(playerPosition) < getLED(boss._pos + BOSS_WIDTH))
-        {
-            die();
-            return;
-        }
-        // CHECK FOR ATTACK
-        if (attacking)
+        const int first = getLED(boss._pos - BOSS_WIDTH / 2);
+        const int last = getLED(boss._pos + BOSS_WIDTH / 2);
+        render_fill(first, last, CRGB::DarkRed);
+        render_scale(first, last, 100);
+    }
+}
+
+// ---------------------------------
+// ---------- COLLISIONS -----------
+// ---------------------------------
+/* All hits of a frame are found in one pass in world coordinates: the
+   enemies are sorted by position and swept once against the lava (which
+   the lava index keeps sorted), the attack and the player. The hits are
+   collected first and applied afterwards, so nothing changes under the
+   sweep and the player dies at most once per frame.
+*/
+enum HitType
+{
+    HIT_ENEMY_ATTACKED, // index is the enemyPool index
+    HIT_ENEMY_LAVA,
+    HIT_ENEMY_PLAYER,
+    HIT_BOSS_ATTACKED,
+    HIT_BOSS_PLAYER,
+    HIT_PLAYER_LAVA,
+};
+
+typedef struct HitEvent
+{
+    uint8_t type;
+    uint16_t index;
+} HitEvent;
+
+// one per enemy at most, plus the boss and the player
+#define MAX_HIT_EVENTS (ENEMY_COUNT + 2)
+HitEvent hitEvents[MAX_HIT_EVENTS];
+uint16_t hitEventCount = 0;
+
+void addHit(uint8_t type, uint16_t index)
+{
+    if (hitEventCount < MAX_HIT_EVENTS)
+        hitEvents[hitEventCount++] = {type, index};
+}
+
+void collectHits()
+{
+    // the attack in world coordinates, covering all of its first and last LED
+    int attStart = map(attackStartLED, user_settings.led_offset, user_settings.led_end - 1, 0, VIRTUAL_LED_COUNT);
+    int attEnd = map(attackEndLED + 1, user_settings.led_offset, user_settings.led_end - 1, 0, VIRTUAL_LED_COUNT) - 1;
+
+    hitEventCount = 0;
+    updateLavaIndex();
+
+    if (inLava(playerPosition))
+        addHit(HIT_PLAYER_LAVA, 0);
+
+    if (boss.Alive())
+    {
+        const int bossLeft = boss._pos - BOSS_WIDTH / 2;
+        const int bossRight = boss._pos + BOSS_WIDTH / 2;
+        if (playerPosition > bossLeft && playerPosition < boss._pos + BOSS_WIDTH)
+            addHit(HIT_BOSS_PLAYER, 0);
+        else if (attacking && ((attStart >= bossLeft && attStart <= bossRight) || (attEnd >= bossLeft && attEnd <= bossRight)))
+            addHit(HIT_BOSS_ATTACKED, 0);
+    }
+
+    // enemyPool is sorted by position, see tickEnemies()
+    const uint16_t enemyCount = enemyPool.Count();
+    uint16_t lava = 0;
+    for (uint16_t i = 0; i < enemyCount; i++)
+    {
+        Enemy &enemy = enemyPool[i];
+        const int pos = enemy._pos;
+        while (lava < lavaIndex.Count() && lavaIndex.Right(lava) < pos)
+            lava++;
+
+        if (enemy.Alive() && attacking && pos >= attStart && pos <= attEnd)
+            addHit(HIT_ENEMY_ATTACKED, i);
+        else if (enemy.Alive() && lava < lavaIndex.Count() && lavaIndex.Left(lava) <= pos)
+            addHit(HIT_ENEMY_LAVA, i);
+        else if ((enemy.playerSide == 1 && pos <= playerPosition) || (enemy.playerSide == -1 && pos >= playerPosition))
+            addHit(HIT_ENEMY_PLAYER, i);
+    }
+}
+
+void resolveCollisions()
+{
+    collectHits();
+
+    bool playerHit = false;
+    for (uint16_t h = 0; h < hitEventCount; h++)
+    {
+        const HitEvent &hit = hitEvents[h];
+        switch (hit.type)
         {
-            bool attackStartInsideBoss = attackStartLED <= getLED(boss._pos + BOSS_WIDTH / 2) && attackStartLED >= getLED(boss._pos - BOSS_WIDTH / 2);
-            bool attackEndInsideBoss   = attackEndLED   <= getLED(boss._pos + BOSS_WIDTH / 2) && attackEndLED   >= getLED(boss._pos - BOSS_WIDTH / 2);
-            if (attackStartInsideBoss || attackEndInsideBoss)
-            {
-                boss.Hit();
-                if (boss.Alive())
-                {
-                    moveBoss();
-                }
-                else
-                {
-                    spawnPool[0].Kill();
-                    spawnPool[1].Kill();
-                }
-            }
+        case HIT_ENEMY_ATTACKED:
+        case HIT_ENEMY_LAVA:
+            enemyPool[hit.index].Kill();
+            particles.Emit(ENEMY_KILL_BURST, enemyPool[hit.index]._pos);
+            SFXkill();
+            break;
+        case HIT_BOSS_ATTACKED:
+            particles.Emit(BOSS_HIT_BURST, boss._pos);
+            boss.Hit();
+            if (boss.Alive())
+                moveBoss();
+            else
+                killBossSpawners();
+            break;
+        case HIT_ENEMY_PLAYER:
+        case HIT_BOSS_PLAYER:
+        case HIT_PLAYER_LAVA:
+            playerHit = true;
+            break;
         }
     }
+
+    // killed enemies go back to the pool only now, that moves indexes around
+    enemyPool.Reap([](Enemy &enemy) { return !enemy.Alive(); });
+
+    if (playerHit)
+        die();
 }
 
 void drawPlayer()
 {
-    leds[getLED(playerPosition)] = CRGB(0, 255, 0);
+    render_set(getLED(playerPosition), CRGB(0, 255, 0));
 }
 
 void drawExit()
 {
     if (!boss.Alive())
     {
-        leds[user_settings.led_end - 1] = CRGB(0, 0, 255);
+        render_set(user_settings.led_end - 1, CRGB(0, 0, 255));
     }
 }
 
-void tickSpawners()
+void tickSpawners(const FrameTime &ft)
 {
-    const CRGB defaultCol = CRGB(LAVA_OFF_BRIGHTNESS, LAVA_OFF_BRIGHTNESS / 1.5, 0);
+    const CRGB defaultCol = CRGB(LAVA_OFF_BRIGHTNESS, LAVA_OFF_BRIGHTNESS * 2 / 3, 0);
     const CRGB warnCol = CRGB(LAVA_OFF_BRIGHTNESS * 2, LAVA_OFF_BRIGHTNESS * 2, 0);
-    unsigned long mm = millis();
-    for (int s = 0; s < SPAWN_COUNT; s++)
+    unsigned long mm = ft.ms;
+    for (int s = 0; s < spawnPool.Count(); s++)
     {
-        if (!spawnPool[s].Alive())
-            continue;
-        if (mm - spawnPool[s]._lastSpawned > spawnPool[s]._rate + spawnPool[s]._delayOnce)
+        Spawner &spawner = spawnPool[s];
+        if (mm - spawner._lastSpawned > spawner._rate + spawner._delayOnce)
         {
-            spawnEnemy(spawnPool[s]._pos, spawnPool[s]._dir, spawnPool[s]._sp, 0);
-            spawnPool[s]._lastSpawned = mm;
-            spawnPool[s]._delayOnce = 0;
+            spawnEnemy(spawner._pos, spawner._dir, spawner._sp, 0);
+            spawner._lastSpawned = mm;
+            spawner._delayOnce = 0;
         }
-        long nextSpawn = spawnPool[s]._lastSpawned + spawnPool[s]._rate + spawnPool[s]._delayOnce;
+        long nextSpawn = spawner._lastSpawned + spawner._rate + spawner._delayOnce;
         if (nextSpawn - mm < 800)
         {
-            leds[getLED(spawnPool[s]._pos)] = (nextSpawn - mm) % 200 < 100 ? defaultCol : warnCol;
+            render_set(getLED(spawner._pos), (nextSpawn - mm) % 200 < 100 ? defaultCol : warnCol);
         }
         else
         {
-            leds[getLED(spawnPool[s]._pos)] = defaultCol;
+            render_set(getLED(spawner._pos), defaultCol);
         }
     }
 }
 
-void tickLava()
+void tickLava(const FrameTime &ft)
 {
-    int A, B, p, i, brightness, flicker;
-    long mm = millis();
-
-    Lava LP;
-    for (i = 0; i < LAVA_COUNT; i++)
-    {
-        LP = lavaPool[i];
-        if (LP.Alive())
+    int A, B, i;
+    long mm = ft.ms;
+
+    lavaTexture.Scroll();
+    for (i = 0; i < lavaPool.Count(); i++)
+    {
+        Lava &LP = lavaPool[i];
+        if (LP.Update(ft.step)) // for grow and flow
+            lavaIndexDirty = true;
+        A = getLED(LP._left);
+        B = getLED(LP._right);
+        // drawn in the state it had before this frame switched it, as always
+        lavaTexture.Fill(leds, A, B, LP._state);
+        render_dirty(A, B);
+        if (LP._state == Lava::OFF)
         {
-            LP.Update(); // for grow and flow
-            A = getLED(LP._left);
-            B = getLED(LP._right);
-            if (LP._state == Lava::OFF)
+            if (LP._lastOn + LP._offtime < mm)
             {
-                if (LP._lastOn + LP._offtime < mm)
-                {
-                    LP._state = Lava::ON;
-                    LP._lastOn = mm;
-                }
-                for (p = A; p <= B; p++)
-                {
-                    flicker = random8(LAVA_OFF_BRIGHTNESS);
-                    leds[p] = CRGB(LAVA_OFF_BRIGHTNESS + flicker, (LAVA_OFF_BRIGHTNESS + flicker) / 1.5, 0);
-                }
+                LP._state = Lava::ON;
+                LP._lastOn = mm;
+                lavaIndexDirty = true;
             }
-            else if (LP._state == Lava::ON)
+        }
+        else if (LP._state == Lava::ON)
+        {
+            if (LP._lastOn + LP._ontime < mm)
             {
-                if (LP._lastOn + LP._ontime < mm)
-                {
-                    LP._state = Lava::OFF;
-                    LP._lastOn = mm;
-                }
-                for (p = A; p <= B; p++)
-                {
-                    if (random8(30) < 29)
-                        leds[p] = CRGB(150, 0, 0);
-                    else
-                        leds[p] = CRGB(180, 100, 0);
-                }
+                LP._state = Lava::OFF;
+                LP._lastOn = mm;
+                lavaIndexDirty = true;
             }
         }
-        lavaPool[i] = LP;
     }
 }
 
-bool tickParticles()
+bool tickParticles(const FrameTime &ft)
 {
-    bool stillActive = false;
+    // The drag and the bounce are tuned to steps of a frame at SPEED_BASE_FPS,
+    // so they keep stepping at that rate, whatever the real one is
+    static Fixed steps = 0;
     uint8_t brightness;
-    for (int p = 0; p < PARTICLE_COUNT; p++)
+    bool stillActive = particles.Count() > 0;
+    for (steps += ft.step; steps >= 1; steps -= 1)
+        stillActive = particles.Tick();
+    for (int p = 0; p < particles.Count(); p++)
     {
-        if (particlePool[p].Alive())
+        int power = particles.Power(p);
+        if (power < 5)
         {
-            particlePool[p].Tick();
-
-            if (particlePool[p]._power < 5)
-            {
-                brightness = (5 - particlePool[p]._power) * 10;
-                leds[getLED(particlePool[p]._pos)] += CRGB(brightness, brightness / 2, brightness / 2);
-            }
-            else
-                leds[getLED(particlePool[p]._pos)] += CRGB(particlePool[p]._power, 0, 0);
-
-            stillActive = true;
+            brightness = (5 - power) * 10;
+            render_add(getLED(particles.Pos(p)), CRGB(brightness, brightness / 2, brightness / 2));
         }
+        else
+            render_add(getLED(particles.Pos(p)), CRGB(power, 0, 0));
     }
     return stillActive;
 }
 
-void tickConveyors()
-{
-    long m = 10000 + millis();
-    playerPositionModifier = 0;
+#define CONVEYOR_LEVELS 5 // brightness levels in conveyor
+// a whole number of periods, one memcpy() per this many LEDs
+#define CONVEYOR_PATTERN_LEN (CONVEYOR_LEVELS * 16)
+
+// The conveyor brightness pattern as it repeats along the strip, once with
+// the level going up from LED to LED and once going down. Filled in setup().
+CRGB conveyorPatternUp[CONVEYOR_PATTERN_LEN];
+CRGB conveyorPatternDown[CONVEYOR_PATTERN_LEN];
 
-    static const int levels = 5; // brightness levels in conveyor
+void buildConveyorPatterns()
+{
     // For WS2812 LEDs this looks good with user_settings.led_brightness > 50
     // for lower led_brightness values you might want to increase 
     // MIN_BRIGHTNESS and CONVEYOR_BRIGHTNESS
-    static const int brightnessMap[levels] = {
+    static const int brightnessMap[CONVEYOR_LEVELS] = {
         MIN_BRIGHTNESS, 
         MIN_BRIGHTNESS + (CONVEYOR_BRIGHTNESS - MIN_BRIGHTNESS) / 12,
         MIN_BRIGHTNESS + (CONVEYOR_BRIGHTNESS - MIN_BRIGHTNESS) / 6,
@@ -1077,47 +1164,74 @@ void tickConveyors()
         CONVEYOR_BRIGHTNESS,
     };
 
-    for (int i = 0; i < CONVEYOR_COUNT; i++)
+    for (int j = 0; j < CONVEYOR_PATTERN_LEN; j++)
+    {
+        int up = brightnessMap[j % CONVEYOR_LEVELS];
+        int down = brightnessMap[(CONVEYOR_LEVELS - j % CONVEYOR_LEVELS) % CONVEYOR_LEVELS];
+        conveyorPatternUp[j] = CRGB(up, up, up);
+        conveyorPatternDown[j] = CRGB(down, down, down);
+    }
+}
+
+// leds[first..last] from pattern, starting at pattern[phase]
+void fillConveyorPattern(int first, int last, const CRGB *pattern, int phase)
+{
+    render_dirty(first, last);
+    int led = first;
+    while (led <= last)
     {
-        if (! conveyorPool[i]._alive)
-            continue;
+        const int n = min(last - led + 1, CONVEYOR_PATTERN_LEN - phase);
+        memcpy(&leds[led], &pattern[phase], n * sizeof(CRGB));
+        led += n;
+        phase = 0;
+    }
+}
 
+// A conveyor over leds[firstLed..lastLed], shifted by shift LEDs. The level
+// of an LED is abs((shift - led) % CONVEYOR_LEVELS), which goes down from LED
+// to LED up to the shift and up after it (C's % keeps the sign). Conveyors
+// moving towards the goal have a shift past every LED, towards the start one
+// before them.
+void fillConveyor(int firstLed, int lastLed, long shift)
+{
+    int downEnd = constrain(shift, firstLed - 1, lastLed);
+    if (downEnd >= firstLed)
+        fillConveyorPattern(firstLed, downEnd, conveyorPatternDown, ((firstLed - shift) % CONVEYOR_LEVELS + CONVEYOR_LEVELS) % CONVEYOR_LEVELS);
+    if (downEnd < lastLed)
+        fillConveyorPattern(downEnd + 1, lastLed, conveyorPatternUp, (downEnd + 1 - shift) % CONVEYOR_LEVELS);
+}
+
+void tickConveyors(const FrameTime &ft)
+{
+    long m = 10000 + ft.ms;
+    playerPositionModifier = 0;
+
+    for (int i = 0; i < conveyorPool.Count(); i++)
+    {
         int firstLed = getLED(conveyorPool[i]._startPoint);
         int lastLed = getLED(conveyorPool[i]._endPoint);
-        for (int led = firstLed; led <= lastLed; led++)
-        {
-            // this results in -4..0 for conveyors moving towards start
-            // and 0..4 for conveyors moving towards goal with each led
-            // being +-1 off the last one
-            // conveyors with speed +-5 will "move" at 100ms per LED
-            int n = (-led + (m * conveyorPool[i]._speed / 500)) % levels;
-            // make all values positive for value mapping
-            n = abs(n);
-
-            assert(n >= 0 && n < levels);
-
-            int b = brightnessMap[n];
-            leds[led] = CRGB(b, b, b);
-        }
-
-        if (playerPosition >= conveyorPool[i]._startPoint && playerPosition <= conveyorPool[i]._endPoint)
-        {
-            playerPositionModifier = conveyorPool[i]._speed;
-        }
+        // Conveyors with speed +-5 will "move" at 100ms per LED.
+        fillConveyor(firstLed, lastLed, m * conveyorPool[i]._speed / 500);
     }
+
+    const Conveyor *conveyor = conveyorAt(playerPosition);
+    if (conveyor)
+        playerPositionModifier = conveyor->_speed;
 }
 
-void tickComplete(long mm) // the boss is dead
+void tickComplete(const FrameTime &ft) // the boss is dead
 {
+    long mm = ft.ms;
     int brightness = 0;
-    FastLED.clear();
+    render_clear();
+    render_dirtyWindow(); // drawn directly below
     SFXcomplete();
     if (stageStartTime + 500 > mm)
     {
         int n = mapconstrain(mm - stageStartTime, 0, 500, user_settings.led_end, user_settings.led_offset);
         for (int i = user_settings.led_end-1; i > n; i--)
         {
-            brightness = (sin(((i * 10) + mm) / 500.0) + 1) * 255;
+            brightness = (isin16(isinPhase((i * 10) + mm, isinRate(500.0))) + ISIN_MAX) * 255 / ISIN_MAX;
             leds[i].setHSV(brightness, 255, 50);
         }
     }
@@ -1125,7 +1239,7 @@ void tickComplete(long mm) // the boss is dead
     {
         for (int i = user_settings.led_end-1; i >= user_settings.led_offset; i--)
         {
-            brightness = (sin(((i * 10) + mm) / 500.0) + 1) * 255;
+            brightness = (isin16(isinPhase((i * 10) + mm, isinRate(500.0))) + ISIN_MAX) * 255 / ISIN_MAX;
             leds[i].setHSV(brightness, 255, 50);
         }
     }
@@ -1134,7 +1248,7 @@ void tickComplete(long mm) // the boss is dead
         int n = mapconstrain(mm - stageStartTime, 5000, 5500, user_settings.led_end, user_settings.led_offset);
         for (int i = user_settings.led_offset; i < n; i++)
         {
-            brightness = (sin(((i * 10) + mm) / 500.0) + 1) * 255;
+            brightness = (isin16(isinPhase((i * 10) + mm, isinRate(500.0))) + ISIN_MAX) * 255 / ISIN_MAX;
             leds[i].setHSV(brightness, 255, 50);
         }
     }
@@ -1144,14 +1258,16 @@ void tickComplete(long mm) // the boss is dead
     }
 }
 
-void tickBossKilled(long mm) // boss funeral
+void tickBossKilled(const FrameTime &ft) // boss funeral
 {
+    long mm = ft.ms;
     static uint8_t gHue = 0;
 
     FastLED.setBrightness(min(user_settings.led_brightness * 2, MAX_BRIGHTNESS)); // super bright!
 
     int brightness = 0;
-    FastLED.clear();
+    render_clear();
+    render_dirtyWindow(); // drawn directly below
 
     if (stageStartTime + 6500 > mm)
     {
@@ -1162,14 +1278,14 @@ void tickBossKilled(long mm) // boss funeral
             int idx = user_settings.led_offset + random16(LED_LENGTH - 1);
             leds[idx] += CRGB::White;
         }
-        SFXbosskilled();
+        SFXbosskilled(ft);
     }
     else if (stageStartTime + 7000 > mm)
     {
         int n = mapconstrain(mm - stageStartTime, 5000, 5500, user_settings.led_end, user_settings.led_offset);
         for (int i = user_settings.led_offset; i < n; i++)
         {
-            brightness = (sin(((i * 10) + mm) / 500.0) + 1) * 255;
+            brightness = (isin16(isinPhase((i * 10) + mm, isinRate(500.0))) + ISIN_MAX) * 255 / ISIN_MAX;
             leds[i].setHSV(brightness, 255, 50);
         }
         SFXcomplete();
@@ -1178,14 +1294,15 @@ void tickBossKilled(long mm) // boss funeral
     {
         FastLED.setBrightness(user_settings.led_brightness);
         stage = STARTUP;
-        stageStartTime = millis();
+        stageStartTime = mm;
         save_game_stats(true);
         lives = user_settings.lives_per_level;
     }
 }
 
-void tickDie(long mm)
+void tickDie(const FrameTime &ft)
 {                             // a short bright explosion...particles persist after it.
+    long mm = ft.ms;
     const int duration = 200; // milliseconds
     const int width = 20;     // half width of the explosion
 
@@ -1196,22 +1313,17 @@ void tickDie(long mm)
 
         // fill up
         int n = mapconstrain(mm - stageStartTime, 0, duration, getLED(playerPosition), getLED(playerPosition) + width);
-        for (int i = getLED(playerPosition); i <= n; i++)
-        {
-            leds[i] = CRGB(255, brightness, brightness);
-        }
+        render_fill(getLED(playerPosition), n, CRGB(255, brightness, brightness)); // clipped to the strip
 
         // fill to down
         n = mapconstrain(mm - stageStartTime, 0, duration, getLED(playerPosition), getLED(playerPosition) - width);
-        for (int i = getLED(playerPosition); i >= n; i--)
-        {
-            leds[i] = CRGB(255, brightness, brightness);
-        }
+        render_fill(n, getLED(playerPosition), CRGB(255, brightness, brightness));
     }
 }
 
-void tickGameover(long mm)
+void tickGameover(const FrameTime &ft)
 {
+    long mm = ft.ms;
     int brightness = 0;
     // temporarily reduce brightness, since full strip will light up, which is much brighter in total
     FastLED.setBrightness(user_settings.led_brightness / 4);
@@ -1220,52 +1332,38 @@ void tickGameover(long mm)
     {
         // fill to top
         int n = mapconstrain(mm - stageStartTime, 0, GAMEOVER_SPREAD_DURATION, getLED(playerPosition), user_settings.led_end);
-        for (int i = getLED(playerPosition); i < n; i++)
-        {
-            leds[i] = CRGB(255, 0, 0);
-        }
+        render_fill(getLED(playerPosition), n - 1, CRGB(255, 0, 0));
         // fill to bottom
         n = mapconstrain(mm - stageStartTime, 0, GAMEOVER_SPREAD_DURATION, getLED(playerPosition), user_settings.led_offset);
-        for (int i = getLED(playerPosition); i >= n; i--)
-        {
-            leds[i] = CRGB(255, 0, 0);
-        }
-        SFXgameover();
+        render_fill(n, getLED(playerPosition), CRGB(255, 0, 0));
+        SFXgameover(ft);
     }
     else if (stageStartTime + GAMEOVER_FADE_DURATION > mm) // fade brightness
     {
         brightness = mapconstrain(mm - stageStartTime, GAMEOVER_SPREAD_DURATION, GAMEOVER_FADE_DURATION-500, 255, 0);
 
-        FOREACH_LED(i)
-        {
-            leds[i] = CRGB(brightness, 0, 0);
-        }
+        render_fill(user_settings.led_offset, user_settings.led_end - 1, CRGB(brightness, 0, 0));
         SFXcomplete();
     }
 }
 
-void tickWin(long mm)
+void tickWin(const FrameTime &ft)
 {
-    FastLED.clear();
+    long mm = ft.ms;
+    render_clear();
     // temporarily reduce brightness, since full strip will light up, which is much brighter in total
     FastLED.setBrightness(user_settings.led_brightness / 4);
     if (stageStartTime + WIN_FILL_DURATION > mm)
     {
         int n = mapconstrain(mm - stageStartTime, 0, WIN_FILL_DURATION, user_settings.led_end, user_settings.led_offset); // fill from top to bottom
-        for (int i = user_settings.led_end-1; i >= n; i--)
-        {
-            leds[i] = CRGB(0, 255, 0);
-        }
-        SFXwin();
+        render_fill(n, user_settings.led_end - 1, CRGB(0, 255, 0));
+        SFXwin(ft);
     }
     else if (stageStartTime + WIN_CLEAR_DURATION > mm)
     {
         int n = mapconstrain(mm - stageStartTime, WIN_FILL_DURATION, WIN_CLEAR_DURATION, user_settings.led_end, user_settings.led_offset); // clear from top to bottom
-        for (int i = user_settings.led_offset; i < n; i++)
-        {
-            leds[i] = CRGB(0, 255, 0);
-        }
-        SFXwin();
+        render_fill(user_settings.led_offset, n - 1, CRGB(0, 255, 0));
+        SFXwin(ft);
     }
     else if (stageStartTime + WIN_OFF_DURATION > mm)
     { 
@@ -1281,7 +1379,7 @@ void drawLives()
 {
     // show how many lives are left by drawing a short line of green leds for each life
     SFXcomplete(); // stop any sounds
-    FastLED.clear();
+    render_clear();
 
     static const int ledsPerLife = 4;
 
@@ -1290,62 +1388,79 @@ void drawLives()
     {
         for (int j = 0; j < ledsPerLife; j++)
         {
-            leds[pos++] = CRGB(0, 255, 0);
+            render_set(pos++, CRGB(0, 255, 0));
             FastLEDshowESP32();
         }
-        leds[pos++] = CRGB(0, 0, 0);
-        leds[pos++] = CRGB(0, 0, 0);
+        render_fill(pos, pos + 1, CRGB(0, 0, 0));
+        pos += 2;
         delay(30);
     }
     FastLEDshowESP32();
     delay(500);
-    FastLED.clear();
+    render_clear();
 }
 
-void drawAttack()
+void drawAttack(const FrameTime &ft)
 {
     if (!attacking)
         return;
-    int n = map(millis() - attackMillis, 0, ATTACK_DURATION, 100, 5);
-    for (int i = attackStartLED + 1; i <= attackEndLED - 1; i++)
-    {
-        leds[i] = CRGB(0, 0, n);
-    }
+    int n = map(ft.ms - attackMillis, 0, ATTACK_DURATION, 100, 5);
+    render_fill(attackStartLED + 1, attackEndLED - 1, CRGB(0, 0, n));
     if (n > 90)
     {
         n = 255;
-        leds[getLED(playerPosition)] = CRGB(255, 255, 255);
+        render_set(getLED(playerPosition), CRGB(255, 255, 255));
     }
     else
     {
         n = 0;
-        leds[getLED(playerPosition)] = CRGB(0, 255, 0);
+        render_set(getLED(playerPosition), CRGB(0, 255, 0));
     }
-    leds[attackStartLED] = CRGB(n, n, 255);
-    leds[attackEndLED] = CRGB(n, n, 255);
+    render_set(attackStartLED, CRGB(n, n, 255));
+    render_set(attackEndLED, CRGB(n, n, 255));
 }
 
 int getLED(int pos)
 {
     // The world is 1000 pixels wide, this converts world units into an LED number
-    return mapconstrain(pos, 0, VIRTUAL_LED_COUNT, user_settings.led_offset, user_settings.led_end - 1);
+    return ledLut[constrain(pos, 0, VIRTUAL_LED_COUNT)];
+}
+
+// rebuilds the lava index if a lava was spawned, toggled, grew or flowed
+void updateLavaIndex()
+{
+    if (!lavaIndexDirty)
+        return;
+    lavaIndex.Clear();
+    for (int i = 0; i < lavaPool.Count(); i++)
+    {
+        if (lavaPool[i]._state == Lava::ON)
+            lavaIndex.Add(lavaPool[i]._left, lavaPool[i]._right, i);
+    }
+    lavaIndex.Build();
+    lavaIndexDirty = false;
 }
 
 bool inLava(int pos)
 {
     // Returns if the player is in active lava
-    int i;
-    Lava LP;
-    for (i = 0; i < LAVA_COUNT; i++)
+    updateLavaIndex();
+    return lavaIndex.Find(pos) >= 0;
+}
+
+// the conveyor at world position pos, NULL if there is none
+Conveyor *conveyorAt(int pos)
+{
+    if (conveyorIndexDirty)
     {
-        LP = lavaPool[i];
-        if (LP.Alive() && LP._state == Lava::ON)
-        {
-            if (LP._left <= pos && LP._right >= pos)
-                return true;
-        }
+        conveyorIndex.Clear();
+        for (int i = 0; i < conveyorPool.Count(); i++)
+            conveyorIndex.Add(conveyorPool[i]._startPoint, conveyorPool[i]._endPoint, i);
+        conveyorIndex.Build();
+        conveyorIndexDirty = false;
     }
-    return false;
+    int i = conveyorIndex.Find(pos);
+    return i < 0 ? NULL : &conveyorPool[i];
 }
 
 void updateLives()
@@ -1366,87 +1481,6 @@ void save_game_stats(bool bossKill)
     settings_eeprom_write();
 }
 
-// ---------------------------------
-// ----------- JOYSTICK ------------
-// ---------------------------------
-// returns success (if at least the main gyro could be read)
-
-bool getC64JoystickInput() {
-    joystickTilt = 0;
-    joystickWobble = 0;
-    // Assumes INPUT_PULLUP on all pins, active LOW
-    if (digitalRead(C64_JOY_PIN_UP) == HIGH)  joystickTilt = -90;
-    if (digitalRead(C64_JOY_PIN_DOWN) == HIGH) joystickTilt = 90;
-    if (digitalRead(C64_JOY_PIN_FIRE) == HIGH)  joystickWobble = 30000;
-    Serial.printf("C64 Joystick: tilt=%d, wobble=%d\n", joystickTilt, joystickWobble);
-    return true;
-}
-
-bool getInput()
-{
-    // This is responsible for the player movement speed and attacking.
-    // You can replace it with anything you want that passes a -90..90 value to joystickTilt
-    // and any value to joystickWobble that is >= than ATTACK_THRESHOLD (defined at start)
-    // For example you could use 3 momentary buttons:
-    // if(digitalRead(leftButtonPinNumber) == HIGH) joystickTilt = -90;
-    // if(digitalRead(rightButtonPinNumber) == HIGH) joystickTilt = 90;
-    // if(digitalRead(attackButtonPinNumber) == HIGH) joystickWobble = ATTACK_THRESHOLD;
-
-    bool connected = accelgyro.getMotion6();
-    if (!connected)
-        return false;
-
-    int a = (JOYSTICK_ORIENTATION == 0 ? accelgyro.ax : (JOYSTICK_ORIENTATION == 1 ? accelgyro.ay : accelgyro.az)) / 166;
-    int g = (JOYSTICK_ORIENTATION == 0 ? accelgyro.gx : (JOYSTICK_ORIENTATION == 1 ? accelgyro.gy : accelgyro.gz));
-    int ra = 0;
-    int rg = 0;
-    
-    if (accelgyro_ref.connected)
-    {
-        connected = accelgyro_ref.getMotion6();
-        if (connected)
-        {
-            ra = (JOYSTICK_ORIENTATION == 0 ? accelgyro_ref.ax : (JOYSTICK_ORIENTATION == 1 ? accelgyro_ref.ay : accelgyro_ref.az)) / 166;
-            rg = (JOYSTICK_ORIENTATION == 0 ? accelgyro_ref.gx : (JOYSTICK_ORIENTATION == 1 ? accelgyro_ref.gy : accelgyro_ref.gz));
-            a -= ra;
-            g -= rg;
-        }
-    }
-
-    if (abs(a) < user_settings.joystick_deadzone)
-        a = 0;
-    if (a > 0)
-        a -= user_settings.joystick_deadzone;
-    if (a < 0)
-        a += user_settings.joystick_deadzone;
-    sample_add(&MPUAngleSamples, a);
-    sample_add(&MPUWobbleSamples, g);
-
-    joystickTilt = sample_median(&MPUAngleSamples);
-    if (JOYSTICK_DIRECTION == 1)
-    {
-        joystickTilt = 0 - joystickTilt;
-    }
-    joystickWobble = abs(sample_highest(&MPUWobbleSamples));
-
-#ifdef JOYSTICK_DEBUG
-    static unsigned long lastInputPrint = 0;
-    #define PRINT_INTERVAL 500
-    if (millis() - lastInputPrint > PRINT_INTERVAL)
-    {
-        Serial.printf("Joystick  - a = (%6d, %6d, %6d), g = (%6d, %6d, %6d)\n", 
-                accelgyro.ax, accelgyro.ay, accelgyro.az, accelgyro.gx, accelgyro.gy, accelgyro.gz);
-        Serial.printf("Reference - a = (%6d, %6d, %6d), g = (%6d, %6d, %6d)\n", 
-                accelgyro_ref.ax, accelgyro_ref.ay, accelgyro_ref.az, accelgyro_ref.gx, accelgyro_ref.gy, accelgyro_ref.gz);
-
-        Serial.printf("Result: a = %6d, g = %6d, tilt = %6d, wobble = %6d\n", a, g, joystickTilt, joystickWobble);
-        lastInputPrint = millis();
-    }
-#endif
-
-    return true;
-}
-
 // ---------------------------------
 // -------------- SFX --------------
 // ---------------------------------
@@ -1464,11 +1498,11 @@ bool getInput()
 
 
 */
-void SFXFreqSweepWarble(int duration, int elapsedTime, int freqStart, int freqEnd, int warble)
+void SFXFreqSweepWarble(const FrameTime &ft, int duration, int elapsedTime, int freqStart, int freqEnd, int warble)
 {
     int freq = map_constrain(elapsedTime, 0, duration, freqStart, freqEnd);
     if (warble)
-        warble = map(sin(millis() / 20.0) * 1000.0, -1000, 1000, 0, warble);
+        warble = map(isin16(isinPhase(ft.ms, isinRate(20.0))), -ISIN_MAX, ISIN_MAX, 0, warble);
 
     sound(freq + warble, user_settings.audio_volume);
 }
@@ -1518,37 +1552,37 @@ void SFXtilt(int amount)
     int vol = map(abs(amount), 0, 90, user_settings.audio_volume / 2, user_settings.audio_volume * 3 / 4);
     sound(f, vol);
 }
-void SFXattacking()
+void SFXattacking(const FrameTime &ft)
 {
-    int freq = map(sin(millis() / 2.0) * 1000.0, -1000, 1000, 500, 600);
+    int freq = map(isin16(isinPhase(ft.ms, isinRate(2.0))), -ISIN_MAX, ISIN_MAX, 500, 600);
     if (random8(5) == 0)
     {
         freq *= 3;
     }
     sound(freq, user_settings.audio_volume);
 }
-void SFXdead()
+void SFXdead(const FrameTime &ft)
 {
-    SFXFreqSweepNoise(1000, millis() - killTime, 1000, 10, 200);
+    SFXFreqSweepNoise(1000, ft.ms - killTime, 1000, 10, 200);
 }
 
-void SFXgameover()
+void SFXgameover(const FrameTime &ft)
 {
-    SFXFreqSweepWarble(GAMEOVER_SPREAD_DURATION, millis() - killTime, 440, 20, 60);
+    SFXFreqSweepWarble(ft, GAMEOVER_SPREAD_DURATION, ft.ms - killTime, 440, 20, 60);
 }
 
 void SFXkill()
 {
     sound(2000, user_settings.audio_volume);
 }
-void SFXwin()
+void SFXwin(const FrameTime &ft)
 {
-    SFXFreqSweepWarble(WIN_OFF_DURATION, millis() - stageStartTime, 40, 400, 20);
+    SFXFreqSweepWarble(ft, WIN_OFF_DURATION, ft.ms - stageStartTime, 40, 400, 20);
 }
 
-void SFXbosskilled()
+void SFXbosskilled(const FrameTime &ft)
 {
-    SFXFreqSweepWarble(7000, millis() - stageStartTime, 75, 1100, 60);
+    SFXFreqSweepWarble(ft, 7000, ft.ms - stageStartTime, 75, 1100, 60);
 }
 
 void SFXcomplete()
@@ -1601,9 +1635,9 @@ typedef enum Screensavers
     SAVE_EOL
 } Screensavers;
 
-void screenSaverTick()
+void screenSaverTick(const FrameTime &ft)
 {
-    long mm = millis();
+    long mm = ft.ms;
     Screensavers mode = Screensavers((mm / SCREENSAVER_DURATION_MS) % SAVE_EOL);
 
     SFXcomplete(); // turn off sound...play testing showed this to be a problem
@@ -1615,13 +1649,14 @@ void screenSaverTick()
     case FIRE: FastLED.setBrightness(user_settings.led_brightnessScreensaver / 3); Fire2012(); break;
     case SINELON: sinelon(); break;
     case JUGGLE: juggle(); break;
-    case LED_MARCH: LED_march(); break;
-    case COLOR_WIPE: colorWipes(); break;
-    case COLOR_WHEEL: colorWheel(); break;
-    case COLOR_CIRCLE: colorCircle(); break; 
-    case RANDOM_FLASHES: random_LED_flashes(); break;
+    case LED_MARCH: LED_march(ft); break;
+    case COLOR_WIPE: colorWipes(ft); break;
+    case COLOR_WHEEL: colorWheel(ft); break;
+    case COLOR_CIRCLE: colorCircle(ft); break; 
+    case RANDOM_FLASHES: random_LED_flashes(ft); break;
     default: fadeToBlack(10); break; // for PLACEHOLDER_OFF and unknown states
     }
+    render_dirtyWindow(); // the screensavers draw into leds[] directly
 }
 
 // Fire2012 by Mark Kriegsman, July 2012
@@ -1706,9 +1741,9 @@ void Fire2012()
     }
 }
 
-void LED_march()
+void LED_march(const FrameTime &ft)
 {
-    long mm = millis();
+    long mm = ft.ms;
 
     FOREACH_LED(i)
     {
@@ -1717,8 +1752,8 @@ void LED_march()
 
     // Marching green <> orange
     int n = (mm / 250) % 10;
-    int b = 10 + ((sin(mm / 500.00) + 1) * 20.00);
-    int c = 20 + ((sin(mm / 5000.00) + 1) * 33);
+    int b = 10 + (isin16(isinPhase(mm, isinRate(500.0))) + ISIN_MAX) * 20 / ISIN_MAX;
+    int c = 20 + (isin16(isinPhase(mm, isinRate(5000.0))) + ISIN_MAX) * 33 / ISIN_MAX;
     FOREACH_LED(i)
     {
         if (i % 10 == n)
@@ -1728,9 +1763,9 @@ void LED_march()
     }
 }
 
-void random_LED_flashes()
+void random_LED_flashes(const FrameTime &ft)
 {
-    long mm = millis();
+    long mm = ft.ms;
 
     FOREACH_LED(i)
     {
@@ -1811,50 +1846,50 @@ void juggle()
     memcpy(&oldPos, &pos, sizeof(oldPos));
 }
 
-void colorWipes()
+void colorWipes(const FrameTime &ft)
 {
     // fill led by led with one color after another
     static int mymode = 0;
     switch (mymode)
     {
     case 0:
-        if (colorWipe(CRGB(255, 0, 0), 20))
+        if (colorWipe(ft, CRGB(255, 0, 0), 20))
         {
             mymode++;
         }
         break;
     case 1:
-        if (colorWipe(CRGB(0, 255, 0), 20))
+        if (colorWipe(ft, CRGB(0, 255, 0), 20))
         {
             mymode++;
         }
         break;
     case 2:
-        if (colorWipe(CRGB(0, 0, 255), 20))
+        if (colorWipe(ft, CRGB(0, 0, 255), 20))
         {
             mymode++;
         }
         break;
     case 3:
-        if (colorWipe(CRGB(128, 128, 0), 20))
+        if (colorWipe(ft, CRGB(128, 128, 0), 20))
         {
             mymode++;
         }
         break;
     case 4:
-        if (colorWipe(CRGB(0, 128, 128), 20))
+        if (colorWipe(ft, CRGB(0, 128, 128), 20))
         {
             mymode++;
         }
         break;
     case 5:
-        if (colorWipe(CRGB(128, 0, 128), 20))
+        if (colorWipe(ft, CRGB(128, 0, 128), 20))
         {
             mymode++;
         }
         break;
     default:
-        if (colorWipe(CRGB(85, 85, 85), 20))
+        if (colorWipe(ft, CRGB(85, 85, 85), 20))
         {
             mymode = 0;
         }
@@ -1862,21 +1897,22 @@ void colorWipes()
     }
 }
 
-int colorWipe(CRGB color, int wait)
+int colorWipe(const FrameTime &ft, CRGB color, int wait)
 {
     // fill led by led with one color
     static long rmm = 0;
-    long cmm = millis() - rmm;
+    long cmm = ft.ms - rmm;
     uint32_t i = user_settings.led_offset + (cmm / wait);
 
     if (i >= user_settings.led_end)
     {
-        rmm = millis();
+        rmm = ft.ms;
         cmm = 0;
         if (i == (user_settings.led_end))
         {
             return 1;
         }
+        i = user_settings.led_offset; // restart, e.g. when a frame was skipped
     }
 
     leds[i] = color;
@@ -1884,10 +1920,10 @@ int colorWipe(CRGB color, int wait)
 }
 
 // NOTE: This looks quite choppy with low brightness
-void colorWheel()
+void colorWheel(const FrameTime &ft)
 {
     // cycle hue of each LED with offset between the LEDs
-    long mm = millis();
+    long mm = ft.ms;
     for (int pos = user_settings.led_offset; pos < user_settings.led_end; pos++)
     {
         leds[pos] = CHSV((mm / 10) - (pos * 255 / LED_LENGTH), 255, 255);
@@ -1895,10 +1931,10 @@ void colorWheel()
 }
 
 // NOTE: This looks quite choppy with low brightness
-void colorCircle()
+void colorCircle(const FrameTime &ft)
 {
     // cycle hue of whole stripe
-    long mm = millis();
+    long mm = ft.ms;
     for (int pos = user_settings.led_offset; pos < user_settings.led_end; pos++)
     {
         leds[pos] = CHSV(-mm / 50, 255, 255);
@@ -1908,4 +1944,195 @@ void colorCircle()
 void fadeToBlack(uint8_t byAmountEachFrame)
 {
     fadeToBlackBy(leds + user_settings.led_offset, LED_LENGTH, byAmountEachFrame);
-}
\ No newline at end of file
+}
+// ---------------------------------
+// ------------ NATIVE -------------
+// ---------------------------------
+#ifdef TWANG_NATIVE
+// Hooks for the headless benchmark runner, see native/bench.cpp
+
+int bench_levelCount()
+{
+    return BOSS + 1;
+}
+
+int bench_screensaverCount()
+{
+    return SAVE_EOL;
+}
+
+void bench_setLedCount(int count)
+{
+    settings_set({.code = 'E', .hasValue = true, .newValue = (uint16_t)count});
+}
+
+void bench_startLevel(int num)
+{
+    levelNumber = num;
+    lives = user_settings.lives_per_level;
+    loadLevel(num);
+}
+
+// the virtual clock has to advance this much for the next frame to be due
+uint32_t bench_frameIntervalUs()
+{
+    return frameIntervalUs;
+}
+
+// false once the level was left by winning, game over or the screensaver
+bool bench_inLevel(int num)
+{
+    return levelNumber == num && (stage == PLAY || stage == DEAD);
+}
+
+// returns how many ms the clock has to advance until the screensaver shows mode
+long bench_startScreensaver(int mode)
+{
+    const long cycle = (long)SCREENSAVER_DURATION_MS * SAVE_EOL;
+    long mm = frameTime.ms;
+    long start = (mm / cycle) * cycle + (long)mode * SCREENSAVER_DURATION_MS;
+    if (start < mm)
+        start += cycle;
+
+    stage = SCREENSAVER;
+    FastLED.setBrightness(user_settings.led_brightnessScreensaver);
+    return start - mm;
+}
+
+// INTRO with count wobbling enemies spread over the far end of the world, they
+// never reach the player or the attack. Returns how many fit into the pool.
+int bench_startSwarm(int count)
+{
+    bench_startLevel(INTRO);
+    for (int i = 0; i < count; i++)
+        spawnEnemy(450 + random(400), 0, 1 + random(6), 20 + random(80));
+    return enemyPool.Count();
+}
+
+#ifdef USE_MPU
+// the sensor task's work, the runner calls it before every frame
+void bench_mpuSample()
+{
+    mpu_sample();
+}
+
+bool bench_mpuConnected()
+{
+    return mpuConnected;
+}
+
+// reads the gyro source as a frame does, returns how many samples it took
+int bench_input(int *tilt, int *wobble)
+{
+    static InputState state = {0, 0};
+    const int samples = mpuSamples.Count();
+    gameInput.Get<MpuSource>().Read(&state);
+    *tilt = state.tilt;
+    *wobble = state.wobble;
+    return samples;
+}
+
+// how the game reads the gyro: the accel axis (0..2) of the tilt, the one
+// gravity is on at rest, the gyro axis of the tilt and its sign, the
+// deadzone and whether the tilt is flipped
+void bench_joystickSetup(int *axis, int *restAxis, int *gyroAxis, int *gyroSign, int *deadzone, bool *flipped)
+{
+    *axis = JOYSTICK_ORIENTATION;
+    *restAxis = JOYSTICK_REST_AXIS;
+    *gyroAxis = JOYSTICK_TILT_GYRO_AXIS;
+    *gyroSign = JOYSTICK_TILT_GYRO_SIGN;
+    *deadzone = user_settings.joystick_deadzone;
+    *flipped = JOYSTICK_DIRECTION == 1;
+}
+#endif
+
+// the wobble that attacks
+int bench_attackThreshold()
+{
+    return user_settings.attack_threshold;
+}
+
+#ifdef USE_C64_JOYSTICK
+// reads the C64 joystick source as a frame does
+void bench_c64Input(int *tilt, int *wobble)
+{
+    static InputState state = {0, 0};
+    gameInput.Get<C64Source>().Read(&state);
+    *tilt = state.tilt;
+    *wobble = state.wobble;
+}
+#endif
+
+#ifdef USE_SCRIPTED_INPUT
+// input as if the player gave it, the next frame takes it
+void bench_setInput(int tilt, int wobble)
+{
+    gameInput.Get<ScriptedSource>().Set(tilt, wobble);
+}
+#endif
+
+void bench_printInputStats()
+{
+    printf("%-12s %7s %10s %10s %7s\n", "input", "updates", "avg us", "max us", "errors");
+    for (int i = 0; i < inputStatsCount; i++)
+    {
+        const InputStats *st = inputStats[i];
+        printf("%-12s %7u %10.1f %10u %7u\n", st->name, st->updates,
+               st->updates ? st->latencySumUs / (double)st->updates : 0.0, st->latencyMaxUs, st->errors);
+    }
+}
+
+// maps every world position (and some off the edges) count times, the sum
+// keeps the compiler from dropping the calls
+long bench_getLED(int count)
+{
+    long sum = 0;
+    for (int c = 0; c < count; c++)
+        for (int pos = -10; pos <= VIRTUAL_LED_COUNT + 10; pos++)
+            sum += getLED(pos);
+    return sum;
+}
+
+// the strip and what the lava and conveyor fills in bench.cpp need to draw
+// on it the way the game did before LavaTexture and the conveyor patterns
+void bench_stripSetup(CRGB **strip, int *first, int *last, int *minBrightness, int *maxSpeed)
+{
+    *strip = leds;
+    *first = user_settings.led_offset;
+    *last = user_settings.led_end - 1;
+    *minBrightness = MIN_BRIGHTNESS;
+    *maxSpeed = MAX_PLAYER_SPEED;
+}
+
+// fills first..last with OFF and then ON lava, as tickLava() does
+void bench_lavaTexture(int first, int last)
+{
+    lavaTexture.Scroll();
+    lavaTexture.Fill(leds, first, last, Lava::OFF);
+    lavaTexture.Fill(leds, first, last, Lava::ON);
+}
+
+void bench_conveyor(int first, int last, long shift)
+{
+    fillConveyor(first, last, shift);
+}
+
+// what /metrics would report, summed up over the whole run
+void bench_printProfile()
+{
+    printf("%-12s %7s %10s\n", "stage", "calls", "avg us");
+    for (int s = 0; s < PROF_STAGE_COUNT; s++)
+    {
+        const ProfileStats *ps = &profStats[s];
+        printf("%-12s %7u %10.2f\n", PROF_STAGE_NAMES[s], ps->count,
+               ps->count ? prof_cyclesToUs(ps->sumCycles) / ps->count : 0.0f);
+    }
+    printf("frames that waited for the show: %u\n", showInFlightCount);
+    printf("frames sent: %u, skipped as unchanged: %u\n", showSentCount, showSkippedCount);
+    printf("frame interval at the end: %u us (%.1f fps)\n", frameIntervalUs, 1e6 / frameIntervalUs);
+    printf("pool high water: enemies %u/%u, particles %u/%u, spawners %u/%u, lava %u/%u, conveyors %u/%u\n",
+           enemyPool.HighWater(), ENEMY_COUNT, particles.HighWater(), PARTICLE_COUNT,
+           spawnPool.HighWater(), SPAWN_COUNT, lavaPool.HighWater(), LAVA_COUNT,
+           conveyorPool.HighWater(), CONVEYOR_COUNT);
+}
+#endif
@@ -0,0 +1,87 @@
+#ifndef TILT_FILTER_H
+#define TILT_FILTER_H
+
+#include "Arduino.h"
+#include "iSin.h"
+
+#define TILT_ACCEL_SHIFT 7 // per sample the estimate moves 1/128 of the way to the accel angle
+#define TILT_ACCEL_SHIFT_BLIND 4 // the same while the gyro is off the scale
+#define TILT_GYRO_LIMIT 32000 // raw rate at which the gyro saturates
+#define TILT_GYRO_LSB_PER_DPS 131 // at the default full scale of 250 deg/s
+#define TILT_REST_RATE 262 // raw rate (2 deg/s) below which the sensor counts as at rest
+#define TILT_REST_SAMPLES 500 // samples at rest before they count towards the gyro bias
+#define TILT_BIAS_SHIFT 8 // the bias moves 1/256 of the way per sample at rest
+#define TILT_MAX_DT_US 20000 // a longer gap (a FIFO reset) is not integrated
+
+/*
+	Tilt of one MPU6050 from its accel and gyro, a complementary filter in
+	fixed point.
+
+	The accel gives the absolute angle, but is noisy and thrown off whenever
+	the spring moves, the gyro gives the change of the angle right away, but
+	drifts. So the gyro rate moves the estimate every sample and the accel
+	angle pulls it a little towards itself, which averages its noise over
+	about 1 << TILT_ACCEL_SHIFT samples without delaying the tilt itself.
+	While the gyro is at rest, the rate it reads is its bias, which is
+	learnt and taken off.
+
+	Angles are iSin phases (65536 is a full turn), kept in Q16 internally.
+*/
+class TiltFilter
+{
+public:
+	void Reset()
+	{
+		_started = false;
+		_still = 0;
+		_bias = 0;
+	}
+
+	/** Takes a sample. tiltAccel is the accel axis the tilt shows on
+	 *  (sin of the angle), restAccel the one gravity is on when level (cos),
+	 *  rate the gyro axis the sensor tilts around, positive when tiltAccel
+	 *  grows. dtUs is the time since the last sample.
+	 */
+	void Update(int tiltAccel, int restAccel, int rate, uint32_t dtUs)
+	{
+		const int32_t measured = (int32_t)iatan2(tiltAccel, restAccel) * 65536;
+		if (!_started)
+		{
+			_angle = measured;
+			_started = true;
+			return;
+		}
+
+		const int32_t unbiased = (int32_t)rate * 256 - _bias; // Q8
+		if (abs(unbiased) >= (TILT_REST_RATE << 8))
+			_still = 0;
+		else if (_still < TILT_REST_SAMPLES)
+			_still++;
+		else
+			_bias += unbiased >> TILT_BIAS_SHIFT;
+
+		int shift = TILT_ACCEL_SHIFT;
+		if (abs(rate) < TILT_GYRO_LIMIT && dtUs <= TILT_MAX_DT_US)
+			_angle += (int32_t)(((int64_t)unbiased * dtUs * GYRO_SCALE) >> 26);
+		else
+			shift = TILT_ACCEL_SHIFT_BLIND;
+		// towards the accel angle the short way round, the difference wraps
+		_angle += (int32_t)((uint32_t)measured - (uint32_t)_angle) >> shift;
+	}
+
+	// phase, 0 is level
+	int16_t Angle() const { return _angle >> 16; }
+	// raw gyro rate it reads at rest, in 1/256
+	int32_t Bias() const { return _bias; }
+
+private:
+	// Q8 raw rate * us to Q16 phase, in 1/2^26
+	static constexpr int64_t GYRO_SCALE = (int64_t)(65536.0 * 65536.0 / (256.0 * TILT_GYRO_LSB_PER_DPS * 360 * 1e6) * (1LL << 26) + 0.5);
+
+	int32_t _angle = 0;
+	int32_t _bias = 0;
+	uint16_t _still = 0;
+	bool _started = false;
+};
+
+#endif
@@ -0,0 +1,202 @@
+/*
+	C64 joystick on three GPIOs: up, down and fire, each high while pressed
+	(the pins are pulled down).
+
+	The buttons used to be polled with digitalRead() once per frame, which
+	misses a tap between two frames and takes a bouncing contact as it
+	finds it. Now every edge raises an interrupt, which just takes the time
+	(esp_timer_get_time(), in us) and the new level and pushes them into an
+	SpscRing. loop() drains the ring once per frame with c64_read() and does
+	the debouncing there, on the timestamps: the first edge after
+	C64_DEBOUNCE_US of quiet counts right away, the edges that follow within
+	C64_DEBOUNCE_US are bounce, and if the contact settled on the other
+	level, that counts once the time is up. Every press counts, however short.
+
+	C64Input is the input source on top. Its latency is the time from the
+	edge to the frame that took it, its errors are edges the ring dropped.
+*/
+#ifndef C64_JOYSTICK_H
+#define C64_JOYSTICK_H
+
+#include "Arduino.h"
+#include <atomic>
+#include "esp_timer.h"
+#include "config.h"
+#include "SpscRing.h"
+#include "InputSource.h"
+
+#ifdef USE_C64_JOYSTICK
+
+#define C64_DEBOUNCE_US 5000 // contacts settle within a few ms
+#define C64_EVENT_QUEUE 64	 // edges, a power of two
+
+enum C64Button
+{
+	C64_UP,
+	C64_DOWN,
+	C64_FIRE,
+	C64_BUTTONS
+};
+
+typedef struct C64Event
+{
+	uint32_t us; // esp_timer_get_time() at the edge
+	uint8_t button;
+	bool pressed; // the level after the edge
+} C64Event;
+
+// debounced state of one button, only loop() touches it
+typedef struct C64ButtonState
+{
+	bool pressed;
+	bool raw;			// level of the last edge
+	uint32_t rawUs;		// time of the last edge
+	uint32_t changedUs; // time pressed last changed
+	uint32_t presses;
+} C64ButtonState;
+
+SpscRing<C64Event, C64_EVENT_QUEUE> c64Events;
+// level of every button as the interrupt last saw it, a bit per button, in
+// case the ring was full and dropped the last edges
+static std::atomic<uint8_t> c64Levels{0};
+static const uint8_t c64Pins[C64_BUTTONS] = {C64_JOY_PIN_UP, C64_JOY_PIN_DOWN, C64_JOY_PIN_FIRE};
+static C64ButtonState c64Buttons[C64_BUTTONS];
+static uint32_t c64Dropped = 0; // c64Events.Dropped() as c64_read() last saw it
+
+static void IRAM_ATTR c64_edge(void *arg)
+{
+	const uint8_t button = (uintptr_t)arg;
+	C64Event e;
+	e.us = esp_timer_get_time();
+	e.button = button;
+	e.pressed = digitalRead(c64Pins[button]) == HIGH;
+	if (e.pressed)
+		c64Levels.fetch_or(1 << button, std::memory_order_relaxed);
+	else
+		c64Levels.fetch_and(~(1 << button), std::memory_order_relaxed);
+	c64Events.Push(e);
+}
+
+// takes the raw level of b as its state once the lockout after the last
+// change is over by nowUs, true if the state changed
+static bool c64_settle(C64ButtonState *b, uint32_t nowUs)
+{
+	if (b->raw == b->pressed || nowUs - b->changedUs < C64_DEBOUNCE_US)
+		return false;
+	// an edge after a quiet time counts when it happened, a level the
+	// contact bounced to when the lockout ended
+	b->changedUs = b->rawUs - b->changedUs >= C64_DEBOUNCE_US ? b->rawUs : b->changedUs + C64_DEBOUNCE_US;
+	b->pressed = b->raw;
+	if (b->pressed)
+		b->presses++;
+	return true;
+}
+
+void c64_start()
+{
+	const uint32_t now = esp_timer_get_time();
+	for (int i = 0; i < C64_BUTTONS; i++)
+	{
+		pinMode(c64Pins[i], INPUT_PULLDOWN);
+		C64ButtonState &b = c64Buttons[i];
+		b.pressed = b.raw = digitalRead(c64Pins[i]) == HIGH;
+		b.rawUs = b.changedUs = now - C64_DEBOUNCE_US;
+		b.presses = 0;
+		if (b.pressed)
+			c64Levels.fetch_or(1 << i);
+		attachInterruptArg(digitalPinToInterrupt(c64Pins[i]), c64_edge, (void *)(uintptr_t)i, CHANGE);
+	}
+}
+
+// Takes the edges since the last call, true if any button changed.
+// c64Buttons has the result.
+bool c64_read()
+{
+	bool changed = false;
+	C64Event e;
+	while (c64Events.Pop(&e))
+	{
+		C64ButtonState *b = &c64Buttons[e.button];
+		changed |= c64_settle(b, e.us); // the level before this edge held until now
+		b->raw = e.pressed;
+		b->rawUs = e.us;
+		changed |= c64_settle(b, e.us);
+	}
+	const uint32_t now = esp_timer_get_time();
+	const uint32_t dropped = c64Events.Dropped();
+	const uint8_t levels = c64Levels.load(std::memory_order_relaxed);
+	for (int i = 0; i < C64_BUTTONS; i++)
+	{
+		C64ButtonState *b = &c64Buttons[i];
+		if (dropped != c64Dropped && (bool)(levels & (1 << i)) != b->raw)
+		{
+			// the ring had no room for the last edges
+			b->raw = !b->raw;
+			b->rawUs = now;
+		}
+		changed |= c64_settle(b, now);
+	}
+	c64Dropped = dropped;
+	return changed;
+}
+
+class C64Input : public InputSource
+{
+public:
+	C64Input() : InputSource("c64") {}
+
+	void Begin()
+	{
+		Serial.print("\r\nCompiled for C64 Joystick");
+		c64_start();
+	}
+
+	bool Read(InputState *state)
+	{
+		uint32_t changedUs[C64_BUTTONS];
+		for (int i = 0; i < C64_BUTTONS; i++)
+			changedUs[i] = c64Buttons[i].changedUs;
+		const uint32_t dropped = c64Events.Dropped();
+		// the buttons as debounced from their edges since the last frame
+		const bool changed = c64_read();
+		Lost(dropped - _dropped);
+		_dropped = dropped;
+		const C64ButtonState &fire = c64Buttons[C64_FIRE];
+		InputState now = {0, 0};
+		if (c64Buttons[C64_UP].pressed)
+			now.tilt = -90;
+		if (c64Buttons[C64_DOWN].pressed)
+			now.tilt = 90;
+		// a tap that is over before the frame attacks as well, for one frame
+		if (fire.pressed || fire.presses != _firePresses)
+			now.wobble = 30000;
+		_firePresses = fire.presses;
+		if (!changed && now.tilt == _last.tilt && now.wobble == _last.wobble)
+			return false;
+		_last = now;
+		*state = now;
+
+		if (changed)
+		{
+			const uint32_t nowUs = esp_timer_get_time();
+			uint32_t latencyUs = 0;
+			for (int i = 0; i < C64_BUTTONS; i++)
+				if (c64Buttons[i].changedUs != changedUs[i])
+					latencyUs = max(latencyUs, nowUs - c64Buttons[i].changedUs);
+			Took(latencyUs);
+		}
+#ifdef JOYSTICK_DEBUG
+		Serial.printf("C64 Joystick: tilt=%d, wobble=%d\n", state->tilt, state->wobble);
+#endif
+		return true;
+	}
+
+private:
+	uint32_t _dropped = 0; // c64Events.Dropped() as Read() last saw it
+	uint32_t _firePresses = 0;
+	InputState _last = {0, 0};
+};
+
+#endif
+
+#endif
@@ -29,8 +29,14 @@
 #define DATA_PIN 23
 #define CLOCK_PIN 17 // only used for APA102/Dotstar
 
+// Input, one or more of (see InputSource.h): a C64 joystick, the gyro in the
+// spring, input set by the host (the native build sets it through build_flags)
 #define USE_C64_JOYSTICK
-// #define USE_MPU // comment this out to use C64 joystick	
+// #define USE_MPU
+// #define USE_SCRIPTED_INPUT
+#define MPU_REFERENCE 1 // 0/1 take the tilt of the reference gyro in the base off, if there is one
+
+// #define JOYSTICK_DEBUG // log the input to the serial port
 
 #ifdef USE_C64_JOYSTICK
 #define C64_JOY_PIN_UP 19
@@ -38,6 +44,10 @@
 #define C64_JOY_PIN_FIRE 16	
 #endif
 
+// INT of the main MPU6050, wakes the sensor task when samples are ready (see
+// mpu_task.h). Without it the task wakes on a timer.
+// #define MPU_INT_PIN 4
+
 #define ATTACK_THRESHOLD 40 // how hard you need to shake to attack
 
 /* Game is rendered to this and scaled down to your strip.
@@ -45,9 +55,16 @@
 #define VIRTUAL_LED_COUNT 1000
 
 // what type of LED Strip....uncomment to define only one of these
+// (skipped if already set through build_flags, see platformio.ini)
+#if !defined(USE_APA102) && !defined(USE_NEOPIXEL)
 // #define USE_APA102
 
 #define USE_NEOPIXEL
+#endif
+
+#if !defined(USE_C64_JOYSTICK) && !defined(USE_MPU) && !defined(USE_SCRIPTED_INPUT)
+#error "You must have USE_C64_JOYSTICK, USE_MPU or USE_SCRIPTED_INPUT defined in config.h"
+#endif
 
 // Check to make sure LED choice was done right
 #if !defined(USE_NEOPIXEL) && !defined(USE_APA102)
@@ -67,17 +84,33 @@
 #define CONVEYOR_BRIGHTNESS 8
 #define LAVA_OFF_BRIGHTNESS 4
 #define MAX_LEDS VIRTUAL_LED_COUNT		  // these LEDS can handle the max
-#define MIN_REDRAW_INTERVAL 1000.0 / 60.0 // divide by frames per second..if you tweak, adjust player speed
+#define MIN_REDRAW_INTERVAL 1000.0 / 120.0 // divide by frames per second, the fastest it gets
+#define MAX_REDRAW_INTERVAL 1000.0 / 20.0 // the slowest it gets on long strips, see frame_pace()
 #endif
 
 #ifdef USE_NEOPIXEL
 #define LED_TYPE NEOPIXEL
 #define CONVEYOR_BRIGHTNESS 40			  // low neopixel values are nearly off, Neopixels need a higher value
 #define LAVA_OFF_BRIGHTNESS 15			  // low neopixel values are nearly off, Neopixels need a higher value
-#define MAX_LEDS 300					  // Neopixels cannot handle the framerate
-#define MIN_REDRAW_INTERVAL 1000.0 / 60.0 // divide by frames per second..if you tweak adjust player speed
+#define MAX_LEDS VIRTUAL_LED_COUNT		  // the frame rate drops below 60 fps from about 450 LEDs, see frame_pace()
+#define MIN_REDRAW_INTERVAL 1000.0 / 60.0 // divide by frames per second, the fastest it gets
+#define MAX_REDRAW_INTERVAL 1000.0 / 20.0 // the slowest it gets on long strips
 #endif
 
+// Speeds in the levels and settings are world units per frame at this frame
+// rate, whatever the real one is, see frame.h
+#define SPEED_BASE_FPS 60
+
+// shortest and longest frame in microseconds, see frame.h
+#define FRAME_INTERVAL_US ((uint32_t)((MIN_REDRAW_INTERVAL) * 1000))
+#define FRAME_INTERVAL_MAX_US ((uint32_t)((MAX_REDRAW_INTERVAL) * 1000))
+
+// Frames that look exactly like the one on the strip are not sent again, only
+// every SHOW_KEEPALIVE_MS in case the strip missed one. Comment out to send
+// every frame, e.g. to keep FastLED's temporal dithering going on still frames.
+#define SKIP_UNCHANGED_FRAMES
+#define SHOW_KEEPALIVE_MS 1000
+
 // Comment or remove the next #define to disable the /metrics endpoint on the HTTP server.
 // This endpoint provides the Twang32 stats for ingestion via Prometheus.
 #define ENABLE_PROMETHEUS_METRICS_ENDPOINT
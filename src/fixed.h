@@ -0,0 +1,70 @@
+/*
+	Fixed point numbers
+
+	The ESP32 has a single precision FPU only, anything with a double in it is
+	emulated in software. Fixed is a signed Q16.16 number (16 integer bits, 16
+	fraction bits) for the parts of the simulation that need fractions, like
+	velocities or the lava growth. It is exact for every integer in the world
+	(0-VIRTUAL_LED_COUNT), so positions can mix with plain ints.
+
+	Fractional constants are made with Fixed::fromFloat(), with a literal the
+	compiler does the conversion, nothing is left to run on the ESP32:
+		Fixed grow = Fixed::fromFloat(0.25);
+*/
+#ifndef FIXED_H
+#define FIXED_H
+
+#include "Arduino.h"
+
+class Fixed
+{
+public:
+	static const int FRAC_BITS = 16;
+	static const int32_t ONE = (int32_t)1 << FRAC_BITS;
+
+	constexpr Fixed() : _raw(0) {}
+	constexpr Fixed(int i) : _raw((int32_t)i * ONE) {}
+
+	static constexpr Fixed fromRaw(int32_t raw) { return Fixed(raw, RawTag()); }
+	static constexpr Fixed fromFloat(double d) { return Fixed((int32_t)(d * ONE + (d < 0 ? -0.5 : 0.5)), RawTag()); }
+
+	constexpr int32_t raw() const { return _raw; }
+	// rounds towards zero, like casting a float to int
+	constexpr int toInt() const { return _raw >= 0 ? _raw >> FRAC_BITS : -(-_raw >> FRAC_BITS); }
+	constexpr Fixed abs() const { return fromRaw(_raw < 0 ? -_raw : _raw); }
+
+	constexpr Fixed operator-() const { return fromRaw(-_raw); }
+	constexpr Fixed operator+(Fixed rhs) const { return fromRaw(_raw + rhs._raw); }
+	constexpr Fixed operator-(Fixed rhs) const { return fromRaw(_raw - rhs._raw); }
+	constexpr Fixed operator*(Fixed rhs) const { return fromRaw((int32_t)(((int64_t)_raw * rhs._raw) >> FRAC_BITS)); }
+	constexpr Fixed operator*(int rhs) const { return fromRaw(_raw * rhs); }
+	constexpr Fixed operator/(int rhs) const { return fromRaw(_raw / rhs); }
+
+	Fixed &operator+=(Fixed rhs)
+	{
+		_raw += rhs._raw;
+		return *this;
+	}
+	Fixed &operator-=(Fixed rhs)
+	{
+		_raw -= rhs._raw;
+		return *this;
+	}
+
+	constexpr bool operator==(Fixed rhs) const { return _raw == rhs._raw; }
+	constexpr bool operator!=(Fixed rhs) const { return _raw != rhs._raw; }
+	constexpr bool operator<(Fixed rhs) const { return _raw < rhs._raw; }
+	constexpr bool operator<=(Fixed rhs) const { return _raw <= rhs._raw; }
+	constexpr bool operator>(Fixed rhs) const { return _raw > rhs._raw; }
+	constexpr bool operator>=(Fixed rhs) const { return _raw >= rhs._raw; }
+
+private:
+	struct RawTag
+	{
+	};
+	constexpr Fixed(int32_t raw, RawTag) : _raw(raw) {}
+
+	int32_t _raw;
+};
+
+#endif
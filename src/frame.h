@@ -0,0 +1,157 @@
+/*
+	Frame clock
+
+	loop() sleeps in frame_wait() until the next frame is due, so it does all
+	of its work (input, web client, sound, game) once per frame and leaves the
+	CPU to other tasks in between. It then reads the time once per frame and
+	hands the resulting FrameTime to every tick, draw and SFX function, so
+	everything done in one frame sees the same timestamp. A frame is due
+	frameIntervalUs after the start of the one before, not whenever loop()
+	gets around to it, so game timing does not depend on how long the
+	previous frame took and the native build can run faster than real time.
+
+	frameIntervalUs is paced to the strip, between FRAME_INTERVAL_US and
+	FRAME_INTERVAL_MAX_US: frame_pace() gets the time the last FastLED.show()
+	took, which grows with the number of LEDs, and keeps the frames long
+	enough for it.
+
+	Speeds in the levels and settings are world units per frame at
+	SPEED_BASE_FPS, FrameTime.step is how many of those frames the current one
+	is long. Movement goes through frame_move(), which scales it to the real
+	frame, so the game plays the same at any frame rate and only looks smoother
+	at a higher one.
+*/
+#ifndef FRAME_H
+#define FRAME_H
+
+#include "Arduino.h"
+#include "esp_timer.h"
+#include "config.h"
+#include "fixed.h"
+
+#define SPEED_BASE_FRAME_US ((uint32_t)(1000000.0 / SPEED_BASE_FPS))
+
+typedef struct FrameTime
+{
+	uint32_t index;	  // frames since boot
+	uint64_t startUs; // game time at the start of this frame
+	uint32_t deltaUs; // game time since the start of the previous frame
+	unsigned long ms; // startUs in ms, same time base as millis()
+	Fixed step;		  // deltaUs in frames at SPEED_BASE_FPS, multiply per frame speeds with it
+} FrameTime;
+
+#define FRAME_PACE_FRAMES 120	   // frames without a slow show before the frames get shorter again
+#define FRAME_PACE_HEADROOM_PCT 25 // room left for the show time to vary
+
+uint32_t frameIntervalUs = FRAME_INTERVAL_US; // length of a frame, see frame_pace()
+
+static esp_timer_handle_t frameTimer = NULL; // wakes frame_wait()
+
+static void frame_timerFired(void *task)
+{
+	xTaskNotifyGive((TaskHandle_t)task);
+}
+
+void frame_restart(FrameTime *ft)
+{
+	ft->startUs = esp_timer_get_time();
+	ft->ms = ft->startUs / 1000;
+}
+
+// call from the task that runs loop(), frame_wait() sleeps in it
+void frame_init(FrameTime *ft)
+{
+	esp_timer_create_args_t timerArgs = {};
+	timerArgs.callback = frame_timerFired;
+	timerArgs.arg = xTaskGetCurrentTaskHandle();
+	timerArgs.name = "frame";
+	esp_timer_create(&timerArgs, &frameTimer);
+
+	ft->index = 0;
+	ft->deltaUs = 0;
+	ft->step = 0;
+	frame_restart(ft);
+}
+
+// Blocks until the next frame is due. A one shot esp_timer set to the start
+// of the frame notifies the task, so it wakes on the microsecond rather than
+// on the next 1 ms RTOS tick, which vTaskDelayUntil() would round the
+// (adaptive) frame interval to. Other notifications, like the one from the
+// show task, only make it check the time again.
+void frame_wait(const FrameTime *ft)
+{
+	const uint64_t due = ft->startUs + frameIntervalUs;
+	const int64_t remainingUs = due - esp_timer_get_time();
+	if (remainingUs <= 0)
+		return;
+
+	esp_timer_stop(frameTimer); // in case the last one is still pending
+	esp_timer_start_once(frameTimer, remainingUs);
+	// the timeout only matters if the timer fails
+	const TickType_t timeout = pdMS_TO_TICKS(FRAME_INTERVAL_MAX_US / 1000) + 1;
+	while ((uint64_t)esp_timer_get_time() < due)
+		ulTaskNotifyTake(pdTRUE, timeout);
+}
+
+// advances ft and returns true if the next frame is due
+bool frame_next(FrameTime *ft)
+{
+	uint64_t now = esp_timer_get_time();
+	uint64_t due = ft->startUs + frameIntervalUs;
+	if (now < due)
+		return false;
+
+	// Stay on the grid, unless we are behind by a whole frame (e.g. after a
+	// blocking EEPROM write). Then start from now rather than rushing through
+	// the missed frames.
+	uint64_t start = (now - due < frameIntervalUs) ? due : now;
+
+	ft->index++;
+	ft->deltaUs = start - ft->startUs;
+	// a frame that comes very late (e.g. after a blocking EEPROM write) does
+	// not teleport anything
+	ft->step = Fixed::fromRaw((int64_t)min(ft->deltaUs, FRAME_INTERVAL_MAX_US) * Fixed::ONE / SPEED_BASE_FRAME_US);
+	ft->startUs = start;
+	ft->ms = start / 1000;
+	return true;
+}
+
+// Whole world units something moving at speed (world units per frame at
+// SPEED_BASE_FPS) covers in this frame, negative when speed is. carry keeps
+// the fraction of a unit (in 1/256) for the next frame, so slow movers still
+// move on fast strips.
+int frame_move(const FrameTime &ft, int speed, uint8_t *carry)
+{
+	const int32_t distance = abs(speed) * (ft.step.raw() >> 8) + *carry;
+	*carry = distance & 0xFF;
+	return speed < 0 ? -(distance >> 8) : distance >> 8;
+}
+
+// Call once per frame with the time the strip needs to show a frame. Frames
+// get longer right away when the show does not fit anymore, and shorter only
+// after FRAME_PACE_FRAMES frames in which every show would have fit into the
+// shorter frame.
+void frame_pace(uint32_t showUs)
+{
+	static uint32_t frames = 0;
+	static uint32_t slowestUs = 0;
+
+	uint32_t neededUs = showUs + showUs / 100 * FRAME_PACE_HEADROOM_PCT;
+	neededUs = constrain(neededUs, FRAME_INTERVAL_US, FRAME_INTERVAL_MAX_US);
+	if (neededUs > frameIntervalUs)
+	{
+		frameIntervalUs = neededUs;
+		frames = 0;
+		slowestUs = 0;
+		return;
+	}
+
+	slowestUs = max(slowestUs, neededUs);
+	if (++frames < FRAME_PACE_FRAMES)
+		return;
+	frameIntervalUs = slowestUs;
+	frames = 0;
+	slowestUs = 0;
+}
+
+#endif
@@ -1,41 +1,123 @@
+/*
+	Integer trig
+
+	Replaces libm sin(), which takes a double and is emulated in software on
+	the ESP32. Angles are a 16 bit phase, 65536 is a full turn, so they wrap
+	for free. Results are Q15 (-32767..32767 is -1..1).
+
+	The 257 entry sine table (one full turn plus a guard entry for the
+	interpolation) is generated by the compiler, isin16() interpolates
+	linearly between entries, which is accurate to about 3 LSB.
+
+	To replace sin(x / d) for an integer x (time in ms, usually), take the
+	rate for d once at compile time and turn x into a phase:
+		const uint32_t RATE = isinRate(500.0);	// sin(ms / 500.0)
+		int16_t s = isin16(isinPhase(ms, RATE));
+*/
+#ifndef ISIN_H
+#define ISIN_H
+
 #include "Arduino.h"
 
-class iSin
-{
-public:
-    int convert(long x);
-
-private:
-    uint8_t isinTable8[91] = {
-        0, 4, 9, 13, 18, 22, 27, 31, 35, 40, 44,
-        49, 53, 57, 62, 66, 70, 75, 79, 83, 87,
-        91, 96, 100, 104, 108, 112, 116, 120, 124, 128,
-        131, 135, 139, 143, 146, 150, 153, 157, 160, 164,
-        167, 171, 174, 177, 180, 183, 186, 190, 192, 195,
-        198, 201, 204, 206, 209, 211, 214, 216, 219, 221,
-        223, 225, 227, 229, 231, 233, 235, 236, 238, 240,
-        241, 243, 244, 245, 246, 247, 248, 249, 250, 251,
-        252, 253, 253, 254, 254, 254, 255, 255, 255, 255};
+#define ISIN_TABLE_BITS 8
+#define ISIN_TABLE_SIZE (1 << ISIN_TABLE_BITS)
+#define ISIN_MAX 32767
+
+// sin() for the compiler, x in [-pi/2, pi/2]
+constexpr double isin_taylor(double x)
+{
+	double term = x;
+	double sum = x;
+	for (int n = 1; n < 12; n++)
+	{
+		term *= -x * x / ((2 * n) * (2 * n + 1));
+		sum += term;
+	}
+	return sum;
+}
+
+struct ISinTable
+{
+	int16_t v[ISIN_TABLE_SIZE + 1];
+
+	constexpr ISinTable() : v()
+	{
+		for (int i = 0; i <= ISIN_TABLE_SIZE; i++)
+		{
+			// fold into [-pi/2, pi/2], where the series converges quickly
+			double x = 2 * M_PI * i / ISIN_TABLE_SIZE;
+			if (x > M_PI / 2 && x <= 3 * M_PI / 2)
+				x = M_PI - x;
+			else if (x > 3 * M_PI / 2)
+				x -= 2 * M_PI;
+			double s = isin_taylor(x) * ISIN_MAX;
+			v[i] = (int16_t)(s < 0 ? s - 0.5 : s + 0.5);
+		}
+	}
 };
 
-int iSin::convert(long x)
-{
-    boolean pos = true; // positive - keeps an eye on the sign.
-    if (x < 0)
-    {
-        x = -x;
-        pos = !pos;
-    }
-    if (x >= 360)
-        x %= 360;
-    if (x > 180)
-    {
-        x -= 180;
-        pos = !pos;
-    }
-    if (x > 90)
-        x = 180 - x;
-    if (pos)
-        return isinTable8[x] / 2;
-    return -isinTable8[x] / 2;
+constexpr ISinTable ISIN_TABLE = ISinTable();
+
+// sine of phase (65536 is a full turn), -32767..32767
+inline int16_t isin16(uint16_t phase)
+{
+	const uint16_t idx = phase >> (16 - ISIN_TABLE_BITS);
+	const int32_t frac = phase & ((1 << (16 - ISIN_TABLE_BITS)) - 1);
+	const int32_t a = ISIN_TABLE.v[idx];
+	const int32_t b = ISIN_TABLE.v[idx + 1];
+	return a + (((b - a) * frac) >> (16 - ISIN_TABLE_BITS));
+}
+
+// cosine of phase, -32767..32767
+inline int16_t icos16(uint16_t phase)
+{
+	return isin16(phase + 16384);
 }
+
+// triangle wave in phase with isin16(), -32767..32767
+inline int16_t itriangle16(uint16_t phase)
+{
+	const int32_t q = (uint16_t)(phase + 16384); // -1 at 0, 1 at 32768
+	const int32_t v = q < 32768 ? q * 2 - 32768 : 98304 - q * 2;
+	return constrain(v, -ISIN_MAX, ISIN_MAX);
+}
+
+// cosine ease in/out, maps 0..65535 to 0..65534 with a gentle start and end
+inline uint16_t iease16(uint16_t x)
+{
+	return ISIN_MAX - icos16(x >> 1);
+}
+
+// Angle of the vector (x, y) as a phase, like atan2(y, x): 0 along +x, 16384
+// along +y, negative below the x axis. Accurate to about 0.25 degrees, with
+// atan(r) ~ pi/4 r + 0.273 r (1 - r) on the first octant.
+inline int16_t iatan2(int32_t y, int32_t x)
+{
+	if (x == 0 && y == 0)
+		return 0;
+	const int32_t ax = abs(x);
+	const int32_t ay = abs(y);
+	const bool steep = ay > ax;
+	const int32_t r = steep ? ((int64_t)ax << 15) / ay : ((int64_t)ay << 15) / ax; // Q15, 0..1
+	int32_t phase = ((8192 * r) >> 15) + ((2847 * ((r * (32768 - r)) >> 15)) >> 15);
+	if (steep)
+		phase = 16384 - phase;
+	if (x < 0)
+		phase = 32768 - phase;
+	return (int16_t)(y < 0 ? -phase : phase);
+}
+
+// phase steps per unit of x, in Q16, for sin(x / divisor); divisor >= 1
+constexpr uint32_t isinRate(double divisor)
+{
+	return (uint32_t)(65536.0 * 65536.0 / (2 * M_PI * divisor) + 0.5);
+}
+
+// the phase of x / divisor, where rate is isinRate(divisor). Overflow of
+// x * rate only drops whole turns.
+inline uint16_t isinPhase(uint32_t x, uint32_t rate)
+{
+	return (x * rate) >> 16;
+}
+
+#endif
@@ -0,0 +1,191 @@
+/*
+	MPU6050 sampling task
+
+	Reading the gyros used to be part of the frame: a blocking I2C transfer
+	per sensor, a busy wait of up to 5 ms when the bus was slow and, while the
+	main gyro was gone, an initialize()/testConnection() every 2 s. Now both
+	sensors sample MPU_SAMPLE_HZ times a second into their FIFOs on their own,
+	and a task on core 0 reads the FIFOs in bursts (400 kHz bus) and hands the
+	samples to loop() through an SpscRing, which loop() drains once per frame
+	without ever waiting. A wobble of the spring is much faster than a frame,
+	this way the game sees all of it, not one snapshot per frame.
+
+	The task wakes every MPU_FIFO_BATCH samples: counted by an interrupt on
+	the INT pin of the main gyro if MPU_INT_PIN (config.h) is wired, on a
+	timer if not.
+
+	The task owns both gyros once mpu_start() was called, it alone talks to
+	them and it alone reconnects the main gyro. loop() (MpuInput) only reads
+	mpuConnected and the samples. The native build has no task, the
+	runner calls mpu_sample() in step with the virtual clock, on an emulated
+	MPU6050 fed from a recorded stream (native/hal/mpu6050.h).
+*/
+#ifndef MPU_TASK_H
+#define MPU_TASK_H
+
+#include "Arduino.h"
+#include <atomic>
+#include "esp_timer.h"
+#include "config.h"
+#include "twang_mpu.h"
+#include "SpscRing.h"
+
+#define MPU_SAMPLE_HZ 1000 // both sensors sample this often
+#define MPU_DLPF 3 // DLPF_CFG, 44 Hz accel and 42 Hz gyro bandwidth
+#define MPU_FIFO_BATCH 5 // samples per wakeup of the task
+#define MPU_SAMPLE_US (1000000 / MPU_SAMPLE_HZ)
+#define MPU_I2C_HZ 400000 // fast mode
+#define MPU_RING_SIZE 128 // samples, 128 ms at 1 kHz, a power of two
+#define MPU_CHECK_INTERVAL_MS 2000 // between attempts to reconnect the main gyro
+#define MPU_TASK_CORE 0 // same core as the show task and WiFi, loop() runs on 1
+#define MPU_TASK_PRIORITY 1 // below the show task
+
+typedef struct MpuSample
+{
+	uint32_t us;	 // esp_timer_get_time() when it was taken
+	MpuMotion main;	 // the gyro in the spring
+	MpuMotion ref;	 // the reference gyro in the base, if hasRef
+	bool hasRef;
+} MpuSample;
+
+SpscRing<MpuSample, MPU_RING_SIZE> mpuSamples;
+std::atomic<bool> mpuConnected{false};	// state of the main gyro
+std::atomic<uint32_t> mpuReconnects{0}; // times the main gyro came back
+
+static Twang_MPU *mpuMain = NULL;
+static Twang_MPU *mpuRef = NULL;
+static uint64_t mpuLastCheckUs = 0;
+#ifndef TWANG_NATIVE
+static TaskHandle_t mpuTaskHandle = NULL; // the native build calls mpu_sample() itself
+#endif
+
+// wakes up a gyro and starts its FIFO, returns connected state
+static bool mpu_connect(Twang_MPU *mpu)
+{
+	mpu->initialize();
+	return mpu->testConnection() && mpu->configureFifo(MPU_SAMPLE_HZ, MPU_DLPF);
+}
+
+// Moves what the FIFOs collected since the last call into mpuSamples, or
+// tries to reconnect the main gyro now and then while it is gone.
+void mpu_sample()
+{
+	const uint64_t now = esp_timer_get_time();
+	if (!mpuMain->connected)
+	{
+		if (now - mpuLastCheckUs < MPU_CHECK_INTERVAL_MS * 1000ULL)
+			return;
+		mpuLastCheckUs = now;
+		if (mpu_connect(mpuMain))
+		{
+			mpuReconnects++;
+			mpuConnected = true;
+			if (mpuRef->connected)
+				mpuRef->resetFifo(); // line the two up again
+		}
+		return;
+	}
+
+	int available = mpuMain->fifoSamples();
+	if (available < 0)
+	{
+		mpuConnected = false;
+		return;
+	}
+	// the reference gyro is not reconnected, see MpuInput
+	bool ref = mpuRef->connected;
+	if (ref)
+	{
+		// both sample on the same clock, so the nth sample of one goes with
+		// the nth of the other, unless one of them lost some in an overflow
+		const int refAvailable = mpuRef->fifoSamples();
+		ref = refAvailable >= 0;
+		if (ref && abs(available - refAvailable) > MPU_FIFO_BATCH)
+		{
+			mpuMain->resetFifo();
+			mpuRef->resetFifo();
+			return;
+		}
+		if (ref)
+			available = min(available, refAvailable);
+	}
+
+	MpuMotion main[MPU_FIFO_BURST];
+	MpuMotion refMotion[MPU_FIFO_BURST];
+	for (int done = 0; done < available;)
+	{
+		const int burst = min(available - done, MPU_FIFO_BURST);
+		if (mpuMain->readFifo(main, burst) < burst)
+		{
+			mpuConnected = false;
+			return;
+		}
+		ref = ref && mpuRef->readFifo(refMotion, burst) == burst;
+		for (int i = 0; i < burst; i++)
+		{
+			MpuSample s;
+			// the last one in the FIFO was taken just now
+			s.us = now - (uint64_t)(available - 1 - done - i) * MPU_SAMPLE_US;
+			s.main = main[i];
+			s.hasRef = ref;
+			if (ref)
+				s.ref = refMotion[i];
+			mpuSamples.Push(s);
+		}
+		done += burst;
+	}
+}
+
+#if defined(MPU_INT_PIN) && !defined(TWANG_NATIVE)
+// data ready pulse of the main gyro, wakes the task every MPU_FIFO_BATCH
+static void IRAM_ATTR mpu_dataReady()
+{
+	static uint8_t pulses = 0;
+	if (++pulses < MPU_FIFO_BATCH)
+		return;
+	pulses = 0;
+	BaseType_t woken = pdFALSE;
+	vTaskNotifyGiveFromISR(mpuTaskHandle, &woken);
+	if (woken)
+		portYIELD_FROM_ISR();
+}
+#endif
+
+void mpu_task(void *pvParameters)
+{
+	const TickType_t period = max((TickType_t)1, (TickType_t)pdMS_TO_TICKS(MPU_FIFO_BATCH * 1000 / MPU_SAMPLE_HZ));
+	TickType_t wake = xTaskGetTickCount();
+	for (;;)
+	{
+#ifdef MPU_INT_PIN
+		// the timeout keeps the reconnecting going while there are no pulses
+		ulTaskNotifyTake(pdTRUE, period * 2);
+#else
+		vTaskDelayUntil(&wake, period);
+#endif
+		mpu_sample();
+	}
+}
+
+// Starts sampling main (and ref, if it is connected), call after both were
+// initialized and tested. Neither may be used by anything else afterwards.
+void mpu_start(Twang_MPU *main, Twang_MPU *ref)
+{
+	mpuMain = main;
+	mpuRef = ref;
+	if (main->connected)
+		main->configureFifo(MPU_SAMPLE_HZ, MPU_DLPF);
+	if (ref->connected)
+		ref->configureFifo(MPU_SAMPLE_HZ, MPU_DLPF);
+	mpuConnected = main->connected;
+	mpuLastCheckUs = esp_timer_get_time();
+#ifndef TWANG_NATIVE
+	xTaskCreatePinnedToCore(mpu_task, "mpu_task", 4096, NULL, MPU_TASK_PRIORITY, &mpuTaskHandle, MPU_TASK_CORE);
+#ifdef MPU_INT_PIN
+	pinMode(MPU_INT_PIN, INPUT);
+	attachInterrupt(digitalPinToInterrupt(MPU_INT_PIN), mpu_dataReady, RISING);
+#endif
+#endif
+}
+
+#endif
@@ -0,0 +1,178 @@
+/*
+	Frame profiler
+
+	Times the stages of a frame with the CPU cycle counter and keeps, per stage,
+	a histogram with fixed buckets (cumulative since boot, for Prometheus) plus
+	min/avg/max over the last PROF_WINDOW_FRAMES frames. Published on /metrics,
+	see wifi_ap.h.
+
+	Wrap the call to measure in PROFILE():
+		PROFILE(PROF_LAVA, tickLava(ft));
+*/
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "Arduino.h"
+#include "config.h"
+
+enum ProfileStage
+{
+	PROF_INPUT,
+	PROF_CONVEYORS,
+	PROF_SPAWNERS,
+	PROF_BOSS,
+	PROF_LAVA,
+	PROF_ENEMIES,
+	PROF_PARTICLES,
+	PROF_COLLISIONS,
+	PROF_DRAW,		// clear, player, attack, exit
+	PROF_ANIMATION, // everything drawn outside of PLAY (startup, win, screensaver...)
+	PROF_AP_CLIENT, // the web client, once per frame like the rest
+	PROF_SHOW,
+	PROF_FRAME, // the whole frame, including all of the above
+
+	PROF_STAGE_COUNT
+};
+
+const char *const PROF_STAGE_NAMES[PROF_STAGE_COUNT] = {
+	"input",
+	"conveyors",
+	"spawners",
+	"boss",
+	"lava",
+	"enemies",
+	"particles",
+	"collisions",
+	"draw",
+	"animation",
+	"ap_client",
+	"show",
+	"frame",
+};
+
+// upper bounds of the histogram buckets in us, ascending, a last +Inf bucket is
+// implied. Fixed rather than taken from FRAME_INTERVAL_US, which can land
+// between them (8333 with APA102) and frame_pace() changes anyway, up to
+// FRAME_INTERVAL_MAX_US.
+const uint32_t PROF_BUCKETS_US[] = {20, 50, 100, 200, 500, 1000, 2000, 5000, 10000, 20000, 50000};
+#define PROF_BUCKET_COUNT (sizeof(PROF_BUCKETS_US) / sizeof(PROF_BUCKETS_US[0]) + 1)
+
+#define PROF_WINDOW_FRAMES 600 // frames over which min/avg/max are taken
+
+typedef struct ProfileWindow
+{
+	uint32_t count;
+	uint64_t sumCycles;
+	uint32_t minCycles;
+	uint32_t maxCycles;
+} ProfileWindow;
+
+typedef struct ProfileStats
+{
+	uint32_t buckets[PROF_BUCKET_COUNT]; // not cumulative, the last one is +Inf
+	uint32_t count;
+	uint64_t sumCycles;
+	ProfileWindow window;	// being collected
+	ProfileWindow lastWindow; // the last complete one, this gets published
+} ProfileStats;
+
+ProfileStats profStats[PROF_STAGE_COUNT];
+uint32_t profCyclesPerUs = 1;
+uint32_t profBucketCycles[PROF_BUCKET_COUNT - 1];
+uint32_t profWindowFrames = 0;
+
+// frames that were ready while the previous show was still in flight
+uint32_t showInFlightCount = 0;
+// frames sent to the strip and frames not sent because nothing changed
+uint32_t showSentCount = 0;
+uint32_t showSkippedCount = 0;
+
+#define PROFILE(stage, code)                                            \
+	do                                                                  \
+	{                                                                   \
+		uint32_t _prof_start = ESP.getCycleCount();                     \
+		code;                                                           \
+		prof_record(stage, ESP.getCycleCount() - _prof_start);          \
+	} while (0)
+
+void prof_resetWindow(ProfileWindow *w)
+{
+	w->count = 0;
+	w->sumCycles = 0;
+	w->minCycles = UINT32_MAX;
+	w->maxCycles = 0;
+}
+
+void prof_init()
+{
+	profCyclesPerUs = getCpuFrequencyMhz();
+	for (size_t b = 0; b < PROF_BUCKET_COUNT - 1; b++)
+		profBucketCycles[b] = PROF_BUCKETS_US[b] * profCyclesPerUs;
+	for (int s = 0; s < PROF_STAGE_COUNT; s++)
+	{
+		memset(&profStats[s], 0, sizeof(profStats[s]));
+		prof_resetWindow(&profStats[s].window);
+		prof_resetWindow(&profStats[s].lastWindow);
+	}
+}
+
+void prof_record(ProfileStage stage, uint32_t cycles)
+{
+	ProfileStats *ps = &profStats[stage];
+
+	size_t b = 0;
+	while (b < PROF_BUCKET_COUNT - 1 && cycles > profBucketCycles[b])
+		b++;
+	ps->buckets[b]++;
+	ps->count++;
+	ps->sumCycles += cycles;
+
+	ps->window.count++;
+	ps->window.sumCycles += cycles;
+	if (cycles < ps->window.minCycles)
+		ps->window.minCycles = cycles;
+	if (cycles > ps->window.maxCycles)
+		ps->window.maxCycles = cycles;
+}
+
+// call once at the end of every frame
+void prof_endFrame()
+{
+	if (++profWindowFrames < PROF_WINDOW_FRAMES)
+		return;
+	profWindowFrames = 0;
+	for (int s = 0; s < PROF_STAGE_COUNT; s++)
+	{
+		profStats[s].lastWindow = profStats[s].window;
+		prof_resetWindow(&profStats[s].window);
+	}
+}
+
+float prof_cyclesToUs(uint64_t cycles)
+{
+	return (float)cycles / profCyclesPerUs;
+}
+
+enum ProfileWindowValue
+{
+	PROF_WINDOW_MIN,
+	PROF_WINDOW_AVG,
+	PROF_WINDOW_MAX
+};
+
+float prof_windowUs(const ProfileWindow *w, ProfileWindowValue value)
+{
+	if (w->count == 0)
+		return 0;
+	switch (value)
+	{
+	case PROF_WINDOW_MIN:
+		return prof_cyclesToUs(w->minCycles);
+	case PROF_WINDOW_MAX:
+		return prof_cyclesToUs(w->maxCycles);
+	default:
+		return prof_cyclesToUs(w->sumCycles) / w->count;
+	}
+}
+
+#endif
@@ -0,0 +1,174 @@
+/*
+	Rendering into the back buffer
+
+	The game draws into leds[] with the span and point functions below. They
+	clip to the active window (led_offset..led_end-1) and keep track of two
+	ranges of LEDs: the ones that may be lit, which is all render_clear() has
+	to blank, and the ones that changed since the last render_push(), which is
+	all it has to copy to the front buffer. Both used to cover all MAX_LEDS in
+	every frame, no matter how short the strip or how dark the frame.
+
+	Code that writes leds[] directly (the screensavers, FastLED's fill_* and
+	fade* functions, ...) has to report what it wrote with render_dirty() or
+	render_dirtyWindow(), or it is neither cleared nor shown.
+*/
+#ifndef RENDER_H
+#define RENDER_H
+
+#include <FastLED.h>
+#include "config.h"
+#include "settings.h"
+
+// Double buffered output: the game draws into leds[] (back buffer), which
+// keeps its content between frames. render_push() copies it into
+// ledsFront[] (front buffer), which only the show task on core 0 reads, so the
+// next frame can be drawn while the previous one is still being sent out.
+CRGB leds[VIRTUAL_LED_COUNT];
+CRGB ledsFront[MAX_LEDS];
+
+typedef struct RenderRange
+{
+	int16_t first; // empty if first > last
+	int16_t last;
+} RenderRange;
+
+RenderRange renderLit = {0, MAX_LEDS - 1};
+RenderRange renderChanged = {0, MAX_LEDS - 1};
+RenderRange renderWindow = {0, -1}; // the active window at the last render_clear()
+
+void render_range_add(RenderRange *range, int first, int last)
+{
+	if (range->first > range->last)
+	{
+		range->first = first;
+		range->last = last;
+		return;
+	}
+	range->first = min((int)range->first, first);
+	range->last = max((int)range->last, last);
+}
+
+// leds[first..last] were written
+void render_dirty(int first, int last)
+{
+	first = max(first, 0);
+	last = min(last, MAX_LEDS - 1);
+	if (first > last)
+		return;
+	render_range_add(&renderLit, first, last);
+	render_range_add(&renderChanged, first, last);
+}
+
+// all of the active window was written
+void render_dirtyWindow()
+{
+	render_dirty(user_settings.led_offset, user_settings.led_end - 1);
+}
+
+// Blanks all of leds[] if the active window changed since the last call, so
+// nothing is left outside the new one. Returns true if it did.
+bool render_checkWindow()
+{
+	if (renderWindow.first == user_settings.led_offset && renderWindow.last == user_settings.led_end - 1)
+		return false;
+	fill_solid(leds, MAX_LEDS, CRGB::Black);
+	renderLit = {0, -1};
+	renderChanged = {0, MAX_LEDS - 1};
+	renderWindow = {(int16_t)user_settings.led_offset, (int16_t)(user_settings.led_end - 1)};
+	return true;
+}
+
+/** Clears the back buffer, use instead of FastLED.clear(), which would clear
+ *  the front buffer while it is being sent.
+ */
+void render_clear()
+{
+	if (render_checkWindow())
+		return;
+	if (renderLit.first > renderLit.last)
+		return;
+	fill_solid(leds + renderLit.first, renderLit.last - renderLit.first + 1, CRGB::Black);
+	render_range_add(&renderChanged, renderLit.first, renderLit.last);
+	renderLit = {0, -1};
+}
+
+// true if leds[] differs from front, changes that turn out to be none are
+// forgotten, like a fade that reached black
+bool render_pending(const CRGB *front)
+{
+	if (renderChanged.first > renderChanged.last)
+		return false;
+	if (memcmp(front + renderChanged.first, leds + renderChanged.first, (renderChanged.last - renderChanged.first + 1) * sizeof(CRGB)) != 0)
+		return true;
+	renderChanged = {0, -1};
+	return false;
+}
+
+// copies what changed since the last push into front
+void render_push(CRGB *front)
+{
+	if (renderChanged.first > renderChanged.last)
+		return;
+	memcpy(front + renderChanged.first, leds + renderChanged.first, (renderChanged.last - renderChanged.first + 1) * sizeof(CRGB));
+	renderChanged = {0, -1};
+}
+
+// the part of first..last in the active window, false if there is none
+bool render_clip(int *first, int *last)
+{
+	*first = max(*first, (int)user_settings.led_offset);
+	*last = min(*last, user_settings.led_end - 1);
+	return *first <= *last;
+}
+
+void render_fill(int first, int last, const CRGB &color)
+{
+	if (!render_clip(&first, &last))
+		return;
+	fill_solid(leds + first, last - first + 1, color);
+	render_dirty(first, last);
+}
+
+// from at first, to at last and linear in between
+void render_gradient(int first, int last, const CRGB &from, const CRGB &to)
+{
+	const int span = max(last - first, 1);
+	const int start = first;
+	if (!render_clip(&first, &last))
+		return;
+	for (int i = first; i <= last; i++)
+	{
+		const int t = i - start;
+		leds[i] = CRGB(from.r + (to.r - from.r) * t / span,
+					   from.g + (to.g - from.g) * t / span,
+					   from.b + (to.b - from.b) * t / span);
+	}
+	render_dirty(first, last);
+}
+
+// like %= on every LED of the span, scale 255 keeps the colors
+void render_scale(int first, int last, uint8_t scale)
+{
+	if (!render_clip(&first, &last))
+		return;
+	for (int i = first; i <= last; i++)
+		leds[i] %= scale;
+	render_dirty(first, last);
+}
+
+void render_set(int led, const CRGB &color)
+{
+	render_fill(led, led, color);
+}
+
+// adds color to the LED, saturating
+void render_add(int led, const CRGB &color)
+{
+	int last = led;
+	if (!render_clip(&led, &last))
+		return;
+	leds[led] += color;
+	render_dirty(led, led);
+}
+
+#endif
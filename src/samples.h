@@ -1,4 +1,7 @@
-#include <stdlib.h>
+#ifndef SAMPLES_H
+#define SAMPLES_H
+
+#include <stdint.h>
 #include <assert.h>
 
 // Replacement for RunningMedian library with only the features we need for this project
@@ -7,56 +10,87 @@
 // NOTE: We always assume all samples to be filled, since the case of it being partially
 // filled complicates the code a lot, but only accounts for the first few ms of the
 // program starting. So we rather are wrong for these few ms, than be slow and complicated
-// for 99,999% of the rest of the time the program runs.
+// for 99,999% of the rest of the time the program runs. A new window is all zeros.
+//
+// The window length N is a template parameter, so every input can have its own without
+// paying for it at runtime. The running max is a monotonic deque: sample_add() drops the
+// values that can never be the highest again (older and not higher than the new one), so
+// sample_highest() just returns the first left. sample_median() sorts a copy with a
+// sorting network that the compiler unrolls for the given N.
 
-typedef struct Samples 
+template <typename T, uint8_t N>
+struct Samples
 {
-    int values[5];
-    int sorted[5];
-    int index;
-} Samples;
+    // make sure odd count of elements (for simplified median calculation)
+    static_assert(N % 2 != 0, "N has to be odd");
 
-#define SAMPLE_CNT (sizeof(((Samples*)0)->values) / sizeof(((Samples*)0)->values[0]))
+    Samples()
+    {
+        for (uint8_t i = 0; i < N; i++)
+        {
+            values[i] = 0;
+            maxSlots[i] = i; // all zeros, oldest first
+        }
+    }
 
-// make sure odd count of elements (for simplified median calculation)
-static_assert(SAMPLE_CNT % 2 != 0);
-// make sure values is same size as sorted
-static_assert(sizeof(((Samples*)0)->values) == sizeof(((Samples*)0)->sorted));
+    T values[N];
+    uint8_t index = 0; // slot of the oldest value, the next one to replace
+    // slots of the values that can still become the highest, oldest first, each
+    // not higher than the one before, a ring of maxCount starting at maxFirst
+    uint8_t maxSlots[N];
+    uint8_t maxFirst = 0;
+    uint8_t maxCount = N;
+};
 
-void sample_add(Samples *s, int val)
+template <typename T, uint8_t N>
+void sample_add(Samples<T, N> *s, T val)
 {
     assert(s);
-    assert(s->index < SAMPLE_CNT);
+    assert(s->index < N);
+
+    // the oldest value leaves the window, if it was a candidate it was the first
+    if (s->maxCount > 0 && s->maxSlots[s->maxFirst] == s->index)
+    {
+        s->maxFirst = s->maxFirst + 1 == N ? 0 : s->maxFirst + 1;
+        s->maxCount--;
+    }
+    // older values lower than val leave the window before it does
+    while (s->maxCount > 0 && s->values[s->maxSlots[(s->maxFirst + s->maxCount - 1) % N]] < val)
+        s->maxCount--;
+    s->maxSlots[(s->maxFirst + s->maxCount) % N] = s->index;
+    s->maxCount++;
 
     s->values[s->index] = val;
     s->index++;
-    if (s->index == SAMPLE_CNT)
+    if (s->index == N)
         s->index = 0;
 }
 
-int cmp_int(const void *a, const void *b)
+template <typename T, uint8_t N>
+T sample_median(const Samples<T, N> *s)
 {
-    int va = *(const int*)a;
-    int vb = *(const int*)b;
-    return va - vb;
+    // odd-even transposition sort: N rounds of compare and swap of neighbours,
+    // the same ones whatever the values, no calls and no branches on the data
+    T sorted[N];
+    for (uint8_t i = 0; i < N; i++)
+        sorted[i] = s->values[i];
+    for (uint8_t round = 0; round < N; round++)
+    {
+        for (uint8_t i = round & 1; i + 1 < N; i += 2)
+        {
+            const T a = sorted[i];
+            const T b = sorted[i + 1];
+            sorted[i] = a < b ? a : b;
+            sorted[i + 1] = a < b ? b : a;
+        }
+    }
+    return sorted[N / 2];
 }
 
-int sample_median(Samples *s)
+template <typename T, uint8_t N>
+T sample_highest(const Samples<T, N> *s)
 {
-    memcpy(s->sorted, s->values, sizeof(s->values));
-    qsort(s->sorted, SAMPLE_CNT, sizeof(s->values[0]), cmp_int);
-    // normal program loop always adds a value before querying the median invalidating the cache 
-    // if that was not the case we could check for sorted and short circuit to the result
-    return s->sorted[SAMPLE_CNT / 2];
+    return s->values[s->maxSlots[s->maxFirst]];
 }
 
-int sample_highest(Samples *s)
-{
-    int result = s->values[0];
-    for (int idx = 1; idx < SAMPLE_CNT; ++idx)
-    {
-        if (s->values[idx] > result)
-            result = s->values[idx];
-    }
-    return result;
-}
\ No newline at end of file
+#endif
@@ -32,6 +32,13 @@ const uint8_t LIVES_PER_LEVEL = 3;	 // default lives per level
 // JOYSTICK
 #define JOYSTICK_ORIENTATION 1		   // 0, 1 or 2 to set the axis of the joystick
 #define JOYSTICK_DIRECTION 1		   // 0/1 to flip joystick direction
+// The gyro axis the joystick tilts around (with the sign that makes the
+// JOYSTICK_ORIENTATION accel grow) and the accel axis gravity is on when it
+// stands upright, for a sensor lying flat (0, 1) or on its edge (2). If the
+// tilt overshoots or lags behind with JOYSTICK_DEBUG, flip the sign.
+#define JOYSTICK_TILT_GYRO_AXIS (JOYSTICK_ORIENTATION == 0 ? 1 : 0)
+#define JOYSTICK_TILT_GYRO_SIGN (JOYSTICK_ORIENTATION == 1 ? 1 : -1)
+#define JOYSTICK_REST_AXIS (JOYSTICK_ORIENTATION == 2 ? 1 : 2)
 #define DEFAULT_ATTACK_THRESHOLD 30000 // The threshold that triggers an attack
 #define MIN_ATTACK_THRESHOLD 20000
 #define MAX_ATTACK_THRESHOLD 30000
@@ -52,6 +59,9 @@ long lastInputTime = 0;
 #define LED_LENGTH (user_settings.led_end - user_settings.led_offset)
 #define FOREACH_LED(iter) for (int iter = user_settings.led_offset; iter < user_settings.led_end; iter++)
 
+// world position (0-VIRTUAL_LED_COUNT) to LED number, see getLED()
+uint16_t ledLut[VIRTUAL_LED_COUNT + 1];
+
 typedef struct
 {
 	uint8_t settings_version; // stores the settings format version
@@ -94,6 +104,7 @@ settings_param_t settings_fromString(char *line, int len);
 void settings_set(char code, bool hasValue, uint16_t newValue);
 void show_settings_menu();
 void reset_settings();
+void settings_buildLedLut();
 
 const settings_param_t SET_PARAM_INVALID = {0};
 
@@ -108,6 +119,7 @@ uint8_t readIndex = 0;
 void settings_init()
 {
 	settings_eeprom_read();
+	settings_buildLedLut();
 	show_settings_menu();
 	show_game_stats();
 }
@@ -205,11 +217,13 @@ void settings_set(settings_param_t param)
 				user_settings.led_end = constrain(param.newValue, MIN_LEDS, MAX_LEDS);
 				if (user_settings.led_offset > user_settings.led_end-MIN_LEDS)
 					user_settings.led_offset = user_settings.led_end-MIN_LEDS;					
+				settings_buildLedLut();
 				settings_eeprom_write();
 				Serial.printf("Set LED count to %d\r\n", user_settings.led_end);
 				break;
 			case 'O': // LED offset
 				user_settings.led_offset = constrain(param.newValue, 0, user_settings.led_end-MIN_LEDS);
+				settings_buildLedLut();
 				settings_eeprom_write();
 				Serial.printf("Set LED offset to %d\r\n", user_settings.led_offset);
 				break;
@@ -262,6 +276,7 @@ void settings_set(settings_param_t param)
 			break;
 		case 'R': // reset everything
 			reset_settings();
+			settings_buildLedLut();
 			settings_eeprom_write();
 			show_settings_menu();
 			break;
@@ -350,6 +365,17 @@ void show_game_stats()
 	Serial.println(user_settings.boss_kills);
 }
 
+// Must be called whenever led_offset or led_end change. Same mapping as
+// mapconstrain(pos, 0, VIRTUAL_LED_COUNT, led_offset, led_end - 1).
+void settings_buildLedLut()
+{
+	const long first = user_settings.led_offset;
+	const long last = user_settings.led_end - 1;
+	for (long pos = 0; pos < VIRTUAL_LED_COUNT; pos++)
+		ledLut[pos] = (pos * (last - first)) / VIRTUAL_LED_COUNT + first;
+	ledLut[VIRTUAL_LED_COUNT] = last;
+}
+
 void settings_eeprom_read()
 {
 	EEPROM.begin(sizeof(user_settings));
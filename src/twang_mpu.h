@@ -4,6 +4,48 @@
 // B. Dring 2/2018
 // Updated to store connected state and other data in class object
 // JS 06/2025
+// FIFO mode: the chip samples at a fixed rate into its 1 kB FIFO, which is
+// read in bursts of up to MPU_FIFO_BURST samples
+
+#ifndef TWANG_MPU_H
+#define TWANG_MPU_H
+
+#include <Wire.h>
+
+#define MPU_FIFO_RECORD_LEN 12 // accel x, y, z then gyro x, y, z, big endian
+#define MPU_FIFO_BURST 10	   // samples per read, 120 bytes fit the 128 byte I2C buffer
+
+// one sample, in the raw units of the chip
+typedef struct MpuMotion
+{
+	int16_t ax, ay, az;
+	int16_t gx, gy, gz;
+} MpuMotion;
+
+// axis 0..2 (x, y, z) of the accel and the gyro, picked at compile time
+template <int Axis>
+inline int mpu_accel(const MpuMotion &m)
+{
+	static_assert(Axis >= 0 && Axis <= 2, "Axis is 0, 1 or 2");
+	if constexpr (Axis == 0)
+		return m.ax;
+	else if constexpr (Axis == 1)
+		return m.ay;
+	else
+		return m.az;
+}
+
+template <int Axis>
+inline int mpu_gyro(const MpuMotion &m)
+{
+	static_assert(Axis >= 0 && Axis <= 2, "Axis is 0, 1 or 2");
+	if constexpr (Axis == 0)
+		return m.gx;
+	else if constexpr (Axis == 1)
+		return m.gy;
+	else
+		return m.gz;
+}
 
 class Twang_MPU
 {
@@ -14,6 +56,12 @@ public:
 	bool getMotion6(int16_t *xAccel, int16_t *yAccel, int16_t *zAccel, int16_t *xGyro, int16_t *yGyro, int16_t *zGyro);
 	bool testConnection();
 
+	// FIFO mode
+	bool configureFifo(uint16_t sampleHz, uint8_t dlpf);
+	bool resetFifo();
+	int fifoSamples();
+	int readFifo(MpuMotion *samples, int count);
+
 	uint16_t devAddr;
 	bool connected; // cached connected value, updated by testConnection and on error
 	int16_t ax, ay, az;
@@ -27,6 +75,23 @@ private:
 	static const uint8_t MPU_DATA_REG_START = 0x3B;
 	static const uint8_t MPU_DATA_LEN = 14;
 	static const uint8_t MPU_DATA_WHO_AM_I = 0x75;
+	static const uint8_t SMPLRT_DIV = 0x19;
+	static const uint8_t CONFIG = 0x1A;		  // DLPF_CFG in bits 0..2
+	static const uint8_t FIFO_EN = 0x23;
+	static const uint8_t FIFO_EN_ACCEL_GYRO = 0x78; // XG, YG, ZG and ACCEL
+	static const uint8_t INT_PIN_CFG = 0x37;
+	static const uint8_t INT_ENABLE = 0x38;
+	static const uint8_t INT_DATA_RDY = 0x01;
+	static const uint8_t INT_STATUS = 0x3A;
+	static const uint8_t INT_FIFO_OFLOW = 0x10;
+	static const uint8_t USER_CTRL = 0x6A;
+	static const uint8_t USER_CTRL_FIFO_EN = 0x40;
+	static const uint8_t USER_CTRL_FIFO_RESET = 0x04;
+	static const uint8_t FIFO_COUNT_H = 0x72;
+	static const uint8_t FIFO_R_W = 0x74;
+
+	bool writeRegister(uint8_t reg, uint8_t value);
+	bool readRegisters(uint8_t reg, uint8_t *data, uint8_t len);
 };
 
 Twang_MPU::Twang_MPU(uint16_t address)
@@ -72,17 +137,12 @@ bool Twang_MPU::getMotion6(int16_t *xAccel, int16_t *yAccel, int16_t *zAccel, in
 	Wire.beginTransmission(devAddr);
 	Wire.write(MPU_DATA_REG_START); // starting with register 0x3B (ACCEL_XOUT_H)
 	Wire.endTransmission(false);
-	Wire.requestFrom(devAddr, MPU_DATA_LEN, true); // read the whole MPU data section
-	unsigned long timeout = millis();
-	const unsigned long TIMEOUT_MS = 5;
-	while (Wire.available() < MPU_DATA_LEN)
+	// read the whole MPU data section in one burst, requestFrom() returns once
+	// it is in or the bus gave up, so there is nothing to wait for
+	if (Wire.requestFrom(devAddr, MPU_DATA_LEN, true) < MPU_DATA_LEN)
 	{
-		if (millis() - timeout > TIMEOUT_MS)
-		{
-			this->connected = false;
-			return false;
-		}
-		delayMicroseconds(100);
+		this->connected = false;
+		return false;
 	}
 	*xAccel = Wire.read() << 8 | Wire.read(); // x Accel
 	*yAccel = Wire.read() << 8 | Wire.read(); // y Accel
@@ -94,3 +154,93 @@ bool Twang_MPU::getMotion6(int16_t *xAccel, int16_t *yAccel, int16_t *zAccel, in
 	*zGyro = Wire.read() << 8 | Wire.read(); // z Gyro
 	return true;
 }
+
+bool Twang_MPU::writeRegister(uint8_t reg, uint8_t value)
+{
+	Wire.beginTransmission(devAddr);
+	Wire.write(reg);
+	Wire.write(value);
+	return Wire.endTransmission(true) == 0;
+}
+
+bool Twang_MPU::readRegisters(uint8_t reg, uint8_t *data, uint8_t len)
+{
+	Wire.beginTransmission(devAddr);
+	Wire.write(reg);
+	Wire.endTransmission(false);
+	if (Wire.requestFrom(devAddr, len, true) < len)
+		return false;
+	for (uint8_t i = 0; i < len; i++)
+		data[i] = Wire.read();
+	return true;
+}
+
+// Samples accel and gyro at sampleHz (up to 1000) into the FIFO and pulses
+// INT (active high) whenever a sample is ready. dlpf is the DLPF_CFG,
+// 1 (184 Hz) to 6 (5 Hz) bandwidth, it has to be on for the 1 kHz base rate.
+// Returns success and sets connected accordingly.
+bool Twang_MPU::configureFifo(uint16_t sampleHz, uint8_t dlpf)
+{
+	this->connected = writeRegister(SMPLRT_DIV, 1000 / sampleHz - 1) &&
+					  writeRegister(CONFIG, dlpf & 0x07) &&
+					  writeRegister(INT_PIN_CFG, 0) &&
+					  writeRegister(INT_ENABLE, INT_DATA_RDY) &&
+					  writeRegister(FIFO_EN, FIFO_EN_ACCEL_GYRO) &&
+					  resetFifo();
+	return this->connected;
+}
+
+// drops whatever is in the FIFO and keeps it running
+bool Twang_MPU::resetFifo()
+{
+	return writeRegister(USER_CTRL, USER_CTRL_FIFO_RESET) &&
+		   writeRegister(USER_CTRL, USER_CTRL_FIFO_EN);
+}
+
+// Samples waiting in the FIFO, -1 on a bus error (connected is false then).
+// After an overflow the FIFO is reset, the samples in it are lost and so is
+// the alignment of the records, so it reports 0.
+int Twang_MPU::fifoSamples()
+{
+	uint8_t data[2];
+	if (!readRegisters(INT_STATUS, data, 1))
+	{
+		this->connected = false;
+		return -1;
+	}
+	if (data[0] & INT_FIFO_OFLOW)
+		return resetFifo() ? 0 : -1;
+	if (!readRegisters(FIFO_COUNT_H, data, 2))
+	{
+		this->connected = false;
+		return -1;
+	}
+	return (data[0] << 8 | data[1]) / MPU_FIFO_RECORD_LEN;
+}
+
+// Reads count samples (at most what fifoSamples() said) in bursts of up to
+// MPU_FIFO_BURST, returns how many it read
+int Twang_MPU::readFifo(MpuMotion *samples, int count)
+{
+	uint8_t data[MPU_FIFO_BURST * MPU_FIFO_RECORD_LEN];
+	int done = 0;
+	while (done < count)
+	{
+		const int burst = min(count - done, MPU_FIFO_BURST);
+		if (!readRegisters(FIFO_R_W, data, burst * MPU_FIFO_RECORD_LEN))
+		{
+			this->connected = false;
+			break;
+		}
+		for (int i = 0; i < burst; i++)
+		{
+			const uint8_t *r = data + i * MPU_FIFO_RECORD_LEN;
+			samples[done + i] = {(int16_t)(r[0] << 8 | r[1]), (int16_t)(r[2] << 8 | r[3]), (int16_t)(r[4] << 8 | r[5]),
+								 (int16_t)(r[6] << 8 | r[7]), (int16_t)(r[8] << 8 | r[9]), (int16_t)(r[10] << 8 | r[11])};
+		}
+		done += burst;
+	}
+	return done;
+}
+
+#endif
@@ -1,5 +1,10 @@
 #include <WiFi.h>
 #include "settings.h"
+#include "profiler.h"
+#include "InputSource.h"
+#ifdef USE_MPU
+#include "mpu_task.h"
+#endif
 
 const char *ssid = "TWANG_AP";
 const char *passphrase = "12345678";
@@ -138,6 +143,62 @@ void sendStatsPage(WiFiClient client)
 	client.print(value);                                             \
 	client.print("\n");
 
+// Times are in seconds, Prometheus style. printf() is used since print() only
+// prints 2 decimals.
+static void sendProfileHistogram(WiFiClient &client)
+{
+	client.print("# HELP twang_stage_duration_seconds Time spent in each stage of a frame\n");
+	client.print("# TYPE twang_stage_duration_seconds histogram\n");
+	for (int s = 0; s < PROF_STAGE_COUNT; s++)
+	{
+		const ProfileStats *ps = &profStats[s];
+		uint32_t cumulative = 0;
+		for (size_t b = 0; b < PROF_BUCKET_COUNT - 1; b++)
+		{
+			cumulative += ps->buckets[b];
+			client.printf("twang_stage_duration_seconds_bucket{stage=\"%s\",le=\"%g\"} %u\n",
+						  PROF_STAGE_NAMES[s], PROF_BUCKETS_US[b] / 1e6, cumulative);
+		}
+		client.printf("twang_stage_duration_seconds_bucket{stage=\"%s\",le=\"+Inf\"} %u\n", PROF_STAGE_NAMES[s], ps->count);
+		client.printf("twang_stage_duration_seconds_sum{stage=\"%s\"} %.6f\n", PROF_STAGE_NAMES[s], prof_cyclesToUs(ps->sumCycles) / 1e6);
+		client.printf("twang_stage_duration_seconds_count{stage=\"%s\"} %u\n", PROF_STAGE_NAMES[s], ps->count);
+	}
+}
+
+static void sendProfileWindow(WiFiClient &client, const char *name, const char *description, ProfileWindowValue value)
+{
+	client.printf("# HELP %s %s\n", name, description);
+	client.printf("# TYPE %s gauge\n", name);
+	for (int s = 0; s < PROF_STAGE_COUNT; s++)
+	{
+		const ProfileWindow *w = &profStats[s].lastWindow;
+		if (w->count == 0)
+			continue; // no complete window yet, or the stage did not run
+		client.printf("%s{stage=\"%s\"} %.6f\n", name, PROF_STAGE_NAMES[s], prof_windowUs(w, value) / 1e6);
+	}
+}
+
+// per input source: how old the input was when a frame took it, and how much got lost
+static void sendInputStats(WiFiClient &client)
+{
+	client.print("# HELP twang_input_latency_seconds Age of the newest input of a source when a frame took it\n");
+	client.print("# TYPE twang_input_latency_seconds summary\n");
+	for (int i = 0; i < inputStatsCount; i++)
+	{
+		const InputStats *st = inputStats[i];
+		client.printf("twang_input_latency_seconds_sum{source=\"%s\"} %.6f\n", st->name, st->latencySumUs / 1e6);
+		client.printf("twang_input_latency_seconds_count{source=\"%s\"} %u\n", st->name, st->updates);
+	}
+	client.print("# HELP twang_input_latency_max_seconds Oldest input a frame took from a source\n");
+	client.print("# TYPE twang_input_latency_max_seconds gauge\n");
+	for (int i = 0; i < inputStatsCount; i++)
+		client.printf("twang_input_latency_max_seconds{source=\"%s\"} %.6f\n", inputStats[i]->name, inputStats[i]->latencyMaxUs / 1e6);
+	client.print("# HELP twang_input_errors_total Input a source lost (dropped samples or edges, a lost gyro)\n");
+	client.print("# TYPE twang_input_errors_total counter\n");
+	for (int i = 0; i < inputStatsCount; i++)
+		client.printf("twang_input_errors_total{source=\"%s\"} %u\n", inputStats[i]->name, inputStats[i]->errors);
+}
+
 static void sendMetricsPage(WiFiClient client)
 {
 	client.println("HTTP/1.1 200 OK");
@@ -148,6 +209,33 @@ static void sendMetricsPage(WiFiClient client)
 	__prom_metric("twang_total_points", "Total points", user_settings.total_points);
 	__prom_metric("twang_high_score", "High score", user_settings.high_score);
 	__prom_metric("twang_boss_kills", "Boss kills", user_settings.boss_kills);
+
+	client.print("# HELP twang_show_in_flight_total Frames that had to wait for the previous LED show\n");
+	client.print("# TYPE twang_show_in_flight_total counter\n");
+	client.printf("twang_show_in_flight_total %u\n", showInFlightCount);
+	client.print("# HELP twang_show_sent_total Frames sent to the LED strip\n");
+	client.print("# TYPE twang_show_sent_total counter\n");
+	client.printf("twang_show_sent_total %u\n", showSentCount);
+	client.print("# HELP twang_show_skipped_total Frames not sent because they looked like the last one\n");
+	client.print("# TYPE twang_show_skipped_total counter\n");
+	client.printf("twang_show_skipped_total %u\n", showSkippedCount);
+#ifdef USE_MPU
+	client.print("# HELP twang_mpu_samples_dropped_total Gyro samples lost because loop() fell behind\n");
+	client.print("# TYPE twang_mpu_samples_dropped_total counter\n");
+	client.printf("twang_mpu_samples_dropped_total %u\n", mpuSamples.Dropped());
+	client.print("# HELP twang_mpu_reconnects_total Times the main gyro came back after it was lost\n");
+	client.print("# TYPE twang_mpu_reconnects_total counter\n");
+	client.printf("twang_mpu_reconnects_total %u\n", (unsigned)mpuReconnects);
+#endif
+	sendInputStats(client);
+	client.print("# HELP twang_frame_interval_seconds Length of a frame, follows the LED show time\n");
+	client.print("# TYPE twang_frame_interval_seconds gauge\n");
+	client.printf("twang_frame_interval_seconds %.6f\n", frameIntervalUs / 1e6);
+
+	sendProfileHistogram(client);
+	sendProfileWindow(client, "twang_stage_min_seconds", "Shortest time of a stage in the last profiling window", PROF_WINDOW_MIN);
+	sendProfileWindow(client, "twang_stage_avg_seconds", "Average time of a stage in the last profiling window", PROF_WINDOW_AVG);
+	sendProfileWindow(client, "twang_stage_max_seconds", "Longest time of a stage in the last profiling window", PROF_WINDOW_MAX);
 }
 
 #undef __prom_metric
@@ -191,7 +279,7 @@ settings_param_t ap_client_check()
 			}
 			if (c == '\n')
 			{
-				if (strstr(linebuf, "GET /?") > 0)
+				if (strstr(linebuf, "GET /?") != NULL)
 				{
 					String line = String(linebuf);
 